@@ -0,0 +1,56 @@
+#include "bot.h"
+
+// ============================================================================
+// get the next value of the random generator of the bot (xorshift).
+static Uint32 next_random(Bot* bot)
+{
+  Uint32 value = bot->random;
+  value ^= value << 13;
+  value ^= value >> 17;
+  value ^= value << 5;
+  bot->random = value;
+  return value;
+}
+
+// ============================================================================
+
+void bot_init(Bot* bot, int reaction, int error, Uint32 seed)
+{
+  SDL_assert(bot != NULL);
+  SDL_assert(reaction >= 0);
+  SDL_assert(error >= 0);
+
+  bot->reaction = reaction;
+  bot->error = error;
+  bot->aim = 0;
+  bot->aim_interval = -1;
+  bot->random = (seed == 0 ? 1 : seed);
+}
+
+// ============================================================================
+
+int bot_input(Bot* bot, const Match* match, const DynamicObject* paddle, int time)
+{
+  SDL_assert(bot != NULL);
+  SDL_assert(match != NULL);
+  SDL_assert(paddle != NULL);
+
+  // pick a new aiming error periodically to make the bot miss every now and then.
+  int interval = time / BOT_AIM_INTERVAL;
+  if (interval != bot->aim_interval) {
+    bot->aim_interval = interval;
+    bot->aim = (bot->error > 0 ? (int)(next_random(bot) % (2 * bot->error + 1)) - bot->error : 0);
+  }
+
+  // follow the ball as it was seen after the reaction delay.
+  SDL_Rect ball = history_get(&match->ball.history, time - bot->reaction);
+  SDL_Rect rect = state_get(match, paddle, time);
+  int target = ball.y + BALL_HEIGHT / 2 + bot->aim;
+  int center = rect.y + PADDLE_HALF_HEIGHT;
+  if (target < center - PADDLE_VELOCITY) {
+    return UP;
+  } else if (target > center + PADDLE_VELOCITY) {
+    return DOWN;
+  }
+  return NONE;
+}
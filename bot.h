@@ -0,0 +1,34 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "game.h"
+
+// the default delay (ms) after which a bot sees the movement of the ball.
+#define BOT_DEFAULT_REACTION 150
+// the default maximum distance (pixels) a bot misaims the center of its paddle.
+#define BOT_DEFAULT_ERROR 30
+// the interval (ms) after which a bot picks a new aiming error.
+#define BOT_AIM_INTERVAL 500
+
+typedef struct {
+  // the delay (ms) after which the bot sees the movement of the ball.
+  int reaction;
+  // the maximum distance (pixels) the bot misaims the center of its paddle.
+  int error;
+  // the current aiming error (pixels) from the center of the ball.
+  int aim;
+  // the aiming interval of the current aiming error.
+  int aim_interval;
+  // the state of the random generator of the bot.
+  Uint32 random;
+} Bot;
+
+// ============================================================================
+
+// initialize the bot with the given reaction delay, aiming error and random seed.
+void bot_init(Bot* bot, int reaction, int error, Uint32 seed);
+// get the direction (UP/DOWN/NONE) which steers the paddle towards the ball as
+// the ball was seen at the given time minus the reaction delay.
+int bot_input(Bot* bot, const Match* match, const DynamicObject* paddle, int time);
+
+#endif
@@ -0,0 +1,332 @@
+#include "channel.h"
+#include "metrics.h"
+
+// the flag in the reliable count byte telling that the ack fields are valid.
+#define ACK_VALID 0x80
+// the mask of the reliable message count in the reliable count byte.
+#define COUNT_MASK 0x3f
+
+// ============================================================================
+// check whether the sequence number is newer than the other one (with wrapping).
+static int newer(Uint16 sequence, Uint16 other)
+{
+  return (Sint16)(sequence - other) > 0;
+}
+
+// ============================================================================
+// update the retransmission timeout with a round-trip sample.
+static void sample_rtt(Channel* channel, int rtt)
+{
+  if (channel->srtt < 0) {
+    channel->srtt = rtt;
+    channel->rttvar = rtt / 2;
+  } else {
+    int error = (channel->srtt > rtt ? channel->srtt - rtt : rtt - channel->srtt);
+    channel->rttvar = (3 * channel->rttvar + error) / 4;
+    channel->srtt = (7 * channel->srtt + rtt) / 8;
+  }
+  int rto = channel->srtt + 4 * channel->rttvar;
+  channel->rto = SDL_max(CHANNEL_MIN_RTO, SDL_min(rto, CHANNEL_MAX_RTO));
+}
+
+// ============================================================================
+// mark the reliable messages of an acknowledged packet as delivered.
+static void ack_packet(Channel* channel, Uint16 sequence, int now)
+{
+  ChannelPacket* packet = &channel->packets[sequence % CHANNEL_WINDOW];
+  if (packet->sequence != sequence) {
+    return;
+  }
+  sample_rtt(channel, now - packet->time);
+  for (int i = 0; i < packet->count; i++) {
+    Uint16 id = packet->ids[i];
+    if ((Uint16)(id - channel->send_oldest) < (Uint16)(channel->send_next - channel->send_oldest)) {
+      channel->send_pending[id % CHANNEL_WINDOW] = 0;
+    }
+  }
+  packet->sequence = -1;
+}
+
+// ============================================================================
+// mark the remote packet as received. returns zero for a duplicate or a too old packet.
+static int receive_packet(Channel* channel, Uint16 sequence)
+{
+  if (channel->received == 0) {
+    channel->received = 1;
+    channel->remote_sequence = sequence;
+    channel->remote_bits = 0;
+  } else if (newer(sequence, channel->remote_sequence)) {
+    int shift = (Uint16)(sequence - channel->remote_sequence);
+    Uint64 bits = ((Uint64)channel->remote_bits << 1) | 1;
+    channel->remote_bits = (shift > 32 ? 0 : (Uint32)(bits << (shift - 1)));
+    channel->remote_sequence = sequence;
+  } else {
+    int distance = (Uint16)(channel->remote_sequence - sequence);
+    if (distance == 0 || distance > 32 || ((channel->remote_bits >> (distance - 1)) & 1)) {
+      return 0;
+    }
+    channel->remote_bits |= (Uint32)1 << (distance - 1);
+    metrics_add(METRIC_PACKETS_LATE, 1);
+  }
+  return 1;
+}
+
+// ============================================================================
+// check whether the reliable message at the window index should be sent.
+static int is_due(const Channel* channel, int index, int now)
+{
+  if (channel->send_pending[index] == 0) {
+    return 0;
+  }
+  return channel->send_times[index] < 0 || now - channel->send_times[index] >= channel->rto;
+}
+
+// ============================================================================
+
+void channel_init(Channel* channel)
+{
+  SDL_assert(channel != NULL);
+
+  SDL_memset(channel, 0, sizeof(Channel));
+  for (int i = 0; i < CHANNEL_WINDOW; i++) {
+    channel->packets[i].sequence = -1;
+  }
+  channel->srtt = -1;
+  channel->rto = CHANNEL_INITIAL_RTO;
+}
+
+// ============================================================================
+
+int channel_is_reliable(int type)
+{
+  switch (type) {
+    case MESSAGE_HELLO:
+    case MESSAGE_QUIT:
+    case MESSAGE_RESET:
+    case MESSAGE_BALL:
+    case MESSAGE_GOAL:
+    case MESSAGE_END:
+    case MESSAGE_END_OK:
+    case MESSAGE_START:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// ============================================================================
+
+int channel_queue(Channel* channel, const Message* msg)
+{
+  SDL_assert(channel != NULL);
+  SDL_assert(msg != NULL);
+
+  if (channel_pending(channel) >= CHANNEL_WINDOW) {
+    return -1;
+  }
+  int index = channel->send_next % CHANNEL_WINDOW;
+  channel->sends[index] = *msg;
+  channel->send_pending[index] = 1;
+  channel->send_times[index] = -1;
+  channel->send_next++;
+  return 0;
+}
+
+// ============================================================================
+
+int channel_pending(const Channel* channel)
+{
+  SDL_assert(channel != NULL);
+  return (Uint16)(channel->send_next - channel->send_oldest);
+}
+
+// ============================================================================
+
+int channel_has_output(const Channel* channel, int now)
+{
+  SDL_assert(channel != NULL);
+
+  if (channel->ack_pending == 1) {
+    return 1;
+  }
+  for (Uint16 id = channel->send_oldest; id != channel->send_next; id++) {
+    if (is_due(channel, id % CHANNEL_WINDOW, now)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+
+int channel_write(Channel* channel, Uint8* buffer, int size, int now)
+{
+  SDL_assert(channel != NULL);
+  SDL_assert(buffer != NULL);
+  SDL_assert(size >= CHANNEL_HEADER_SIZE);
+
+  // record the packet to match the remote acks with its reliable messages.
+  Uint16 sequence = channel->sequence++;
+  ChannelPacket* packet = &channel->packets[sequence % CHANNEL_WINDOW];
+  packet->sequence = sequence;
+  packet->time = now;
+  packet->count = 0;
+
+  // piggyback the acks of the received remote packets.
+  protocol_write16(buffer, sequence);
+  protocol_write16(buffer + 2, channel->remote_sequence);
+  protocol_write32(buffer + 4, channel->remote_bits);
+  int length = CHANNEL_HEADER_SIZE;
+
+  // add the reliable messages which have not been sent or whose timeout has expired.
+  for (Uint16 id = channel->send_oldest; id != channel->send_next; id++) {
+    int index = id % CHANNEL_WINDOW;
+    if (is_due(channel, index, now) == 0) {
+      continue;
+    }
+    if (length + 2 >= size) {
+      break;
+    }
+    int bytes = protocol_encode(&channel->sends[index], buffer + length + 2, size - length - 2);
+    if (bytes == 0) {
+      break;
+    }
+    metrics_count_sent(channel->sends[index].type, bytes);
+    protocol_write16(buffer + length, id);
+    length += 2 + bytes;
+    channel->sent += (channel->send_times[index] < 0 ? 1 : 0);
+    channel->resent += (channel->send_times[index] < 0 ? 0 : 1);
+    if (channel->send_times[index] >= 0) {
+      metrics_add(METRIC_RETRANSMISSIONS, 1);
+    }
+    channel->send_times[index] = now;
+    packet->ids[packet->count++] = id;
+  }
+  buffer[8] = (Uint8)(packet->count | (channel->received == 1 ? ACK_VALID : 0));
+  channel->ack_pending = 0;
+  metrics_add(METRIC_PACKETS_SENT, 1);
+  return length;
+}
+
+// ============================================================================
+// read the packet into the channel. returns the offset of the unreliable messages or -1.
+static int read_packet(Channel* channel, const Uint8* data, int size, int now)
+{
+  if (size < CHANNEL_HEADER_SIZE) {
+    return -1;
+  }
+
+  // decode the reliable messages before changing any state of the channel.
+  int count = data[8] & COUNT_MASK;
+  if (count > CHANNEL_WINDOW) {
+    return -1;
+  }
+  Uint16 ids[CHANNEL_WINDOW];
+  Message messages[CHANNEL_WINDOW];
+  int lengths[CHANNEL_WINDOW];
+  int offset = CHANNEL_HEADER_SIZE;
+  for (int i = 0; i < count; i++) {
+    if (offset + 2 > size) {
+      return -1;
+    }
+    ids[i] = protocol_read16(data + offset);
+    lengths[i] = protocol_decode(data + offset + 2, size - offset - 2, &messages[i]);
+    if (lengths[i] <= 0) {
+      return -1;
+    }
+    offset += 2 + lengths[i];
+  }
+  if (receive_packet(channel, protocol_read16(data)) == 0) {
+    return -1;
+  }
+
+  // release the reliable messages of all acknowledged packets.
+  if (data[8] & ACK_VALID) {
+    Uint16 ack = protocol_read16(data + 2);
+    Uint32 bits = protocol_read32(data + 4);
+    ack_packet(channel, ack, now);
+    for (int i = 0; i < 32; i++) {
+      if ((bits >> i) & 1) {
+        ack_packet(channel, (Uint16)(ack - 1 - i), now);
+      }
+    }
+    while (channel->send_oldest != channel->send_next
+      && channel->send_pending[channel->send_oldest % CHANNEL_WINDOW] == 0) {
+      channel->send_oldest++;
+    }
+  }
+
+  // buffer the new reliable messages until they can be delivered in order (only
+  // these are counted as received and not the retransmissions of known ones).
+  for (int i = 0; i < count; i++) {
+    int index = ids[i] % CHANNEL_WINDOW;
+    if ((Uint16)(ids[i] - channel->receive_next) < CHANNEL_WINDOW && channel->receive_ready[index] == 0) {
+      channel->receives[index] = messages[i];
+      channel->receive_ready[index] = 1;
+      metrics_count_received(messages[i].type, lengths[i]);
+    }
+  }
+  channel->ack_pending |= (count > 0 ? 1 : 0);
+  return offset;
+}
+
+// ============================================================================
+
+int channel_read(Channel* channel, const Uint8* data, int size, int now)
+{
+  SDL_assert(channel != NULL);
+  SDL_assert(data != NULL);
+
+  metrics_add(METRIC_PACKETS_RECEIVED, 1);
+  int offset = read_packet(channel, data, size, now);
+  if (offset < 0) {
+    metrics_add(METRIC_PACKETS_DROPPED, 1);
+  }
+  return offset;
+}
+
+// ============================================================================
+
+int channel_peek(const Uint8* data, int size, Message* msg)
+{
+  SDL_assert(data != NULL);
+  SDL_assert(msg != NULL);
+
+  if (size < CHANNEL_HEADER_SIZE) {
+    return 0;
+  }
+  int count = data[8] & COUNT_MASK;
+  if (count == 0 || count > CHANNEL_WINDOW) {
+    return 0;
+  }
+  int offset = CHANNEL_HEADER_SIZE;
+  for (int i = 0; i < count; i++) {
+    Message decoded;
+    int length = (offset + 2 > size ? -1 : protocol_decode(data + offset + 2, size - offset - 2, &decoded));
+    if (length <= 0) {
+      return 0;
+    }
+    if (i == 0) {
+      *msg = decoded;
+    }
+    offset += 2 + length;
+  }
+  return 1;
+}
+
+// ============================================================================
+
+int channel_next(Channel* channel, Message* msg)
+{
+  SDL_assert(channel != NULL);
+  SDL_assert(msg != NULL);
+
+  int index = channel->receive_next % CHANNEL_WINDOW;
+  if (channel->receive_ready[index] == 0) {
+    return 0;
+  }
+  *msg = channel->receives[index];
+  channel->receive_ready[index] = 0;
+  channel->receive_next++;
+  return 1;
+}
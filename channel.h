@@ -0,0 +1,97 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <SDL/SDL.h>
+
+#include "protocol.h"
+
+// the amount of tracked packets and unacknowledged reliable messages.
+#define CHANNEL_WINDOW 32
+// the size of the packet header (sequence, ack, ack bits and reliable count).
+#define CHANNEL_HEADER_SIZE 9
+// the packet space (in bytes) reserved for the header and the reliable messages.
+#define CHANNEL_RESERVED_SIZE 160
+// the retransmission timeout (ms) used before the first round-trip sample.
+#define CHANNEL_INITIAL_RTO 250
+// the minimum retransmission timeout (ms).
+#define CHANNEL_MIN_RTO 50
+// the maximum retransmission timeout (ms).
+#define CHANNEL_MAX_RTO 1000
+
+typedef struct {
+  // the sequence number of the packet (-1 for none).
+  int sequence;
+  // the time when the packet was sent.
+  int time;
+  // the amount of reliable messages in the packet.
+  int count;
+  // the ids of the reliable messages in the packet.
+  Uint16 ids[CHANNEL_WINDOW];
+} ChannelPacket;
+
+typedef struct {
+  // the sequence number of the next outgoing packet.
+  Uint16 sequence;
+  // the newest received remote packet sequence.
+  Uint16 remote_sequence;
+  // the received state of the 32 remote packets preceding the newest one.
+  Uint32 remote_bits;
+  // a definition whether any remote packet has been received.
+  int received;
+  // a definition whether received reliable messages should be acknowledged.
+  int ack_pending;
+  // the sent packets indexed by their sequence number.
+  ChannelPacket packets[CHANNEL_WINDOW];
+  // the id of the next queued reliable message.
+  Uint16 send_next;
+  // the id of the oldest unacknowledged reliable message.
+  Uint16 send_oldest;
+  // the queued reliable messages indexed by their id.
+  Message sends[CHANNEL_WINDOW];
+  // a definition whether each queued reliable message is still unacknowledged.
+  int send_pending[CHANNEL_WINDOW];
+  // the time when each queued reliable message was last sent (-1 for never).
+  int send_times[CHANNEL_WINDOW];
+  // the id of the next reliable message to be delivered.
+  Uint16 receive_next;
+  // the received out-of-order reliable messages indexed by their id.
+  Message receives[CHANNEL_WINDOW];
+  // a definition whether each received reliable message awaits delivery.
+  int receive_ready[CHANNEL_WINDOW];
+  // the smoothed round-trip time (ms).
+  int srtt;
+  // the round-trip time variation (ms).
+  int rttvar;
+  // the retransmission timeout (ms).
+  int rto;
+  // the amount of reliable messages sent for the first time.
+  int sent;
+  // the amount of reliable message retransmissions.
+  int resent;
+} Channel;
+
+// ============================================================================
+
+// initialize the channel to have no sent or received packets.
+void channel_init(Channel* channel);
+// check whether the given message type is sent with the reliable channel.
+int channel_is_reliable(int type);
+// queue the message to be sent reliably. returns -1 when the window is full.
+int channel_queue(Channel* channel, const Message* msg);
+// get the amount of reliable messages not yet acknowledged by the remote node.
+int channel_pending(const Channel* channel);
+// check whether the channel has acks or reliable messages to be sent at the given time.
+int channel_has_output(const Channel* channel, int now);
+// write the packet header and the due reliable messages into the buffer.
+// returns the amount of written bytes.
+int channel_write(Channel* channel, Uint8* buffer, int size, int now);
+// read the packet header and the reliable messages from the packet data.
+// returns the offset of the unreliable messages or -1 for a duplicate or malformed packet.
+int channel_read(Channel* channel, const Uint8* data, int size, int now);
+// decode the first reliable message of the packet data without reading it into a channel.
+// returns 1 when the packet is well-formed and contains a reliable message.
+int channel_peek(const Uint8* data, int size, Message* msg);
+// get the next reliable message in order. returns zero when none is available.
+int channel_next(Channel* channel, Message* msg);
+
+#endif
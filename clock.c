@@ -0,0 +1,111 @@
+#include "clock.h"
+#include "game.h"
+
+// ============================================================================
+// select the sample with the lowest round-trip time within the window.
+static ClockSample select_best(const Clock* clock)
+{
+  int count = SDL_min(clock->samples, CLOCK_SAMPLE_WINDOW);
+  ClockSample best = clock->window[0];
+  for (int i = 1; i < count; i++) {
+    if (clock->window[i].rtt < best.rtt) {
+      best = clock->window[i];
+    }
+  }
+  return best;
+}
+
+// ============================================================================
+
+void clock_init(Clock* clock, int adjust, int now)
+{
+  SDL_assert(clock != NULL);
+
+  SDL_memset(clock, 0, sizeof(Clock));
+  clock->adjust = adjust;
+  clock->burst = CLOCK_BURST_SIZE;
+  clock->slewed = now;
+}
+
+// ============================================================================
+
+int clock_next_ping(Clock* clock)
+{
+  SDL_assert(clock != NULL);
+
+  if (clock->burst > 0) {
+    clock->burst--;
+  }
+  return (clock->burst > 0 ? CLOCK_BURST_INTERVAL : NETWORK_PING_INTERVAL);
+}
+
+// ============================================================================
+
+void clock_sample(Clock* clock, int t0, int t1, int t2)
+{
+  SDL_assert(clock != NULL);
+  if (t2 < t0) {
+    return;
+  }
+
+  // store the sample by assuming that the pong was sent halfway the round-trip.
+  ClockSample* sample = &clock->window[clock->samples % CLOCK_SAMPLE_WINDOW];
+  sample->rtt = t2 - t0;
+  sample->offset = t1 - (t0 + (t2 - t0) / 2);
+  sample->time = t2;
+  clock->samples++;
+
+  // samples with the lowest round-trip have the least queuing delay and asymmetry.
+  clock->best = select_best(clock);
+  clock->rtt = clock->best.rtt;
+
+  // estimate the skew from the offset change over a long enough time span.
+  if (clock->samples <= CLOCK_BURST_SIZE) {
+    clock->anchor = clock->best;
+  } else if (clock->best.time - clock->anchor.time >= CLOCK_SKEW_BASELINE) {
+    Sint64 drift = (Sint64)(clock->best.offset - clock->anchor.offset) * 1000000;
+    clock->skew_ppm = (int)(drift / (clock->best.time - clock->anchor.time));
+  }
+
+  // apply the burst samples at once as the match has not yet started.
+  clock->synchronized = 1;
+  if (clock->adjust == 1 && clock->samples <= CLOCK_BURST_SIZE) {
+    clock->offset = clock_target(clock, t2);
+  }
+}
+
+// ============================================================================
+
+int clock_target(const Clock* clock, int now)
+{
+  SDL_assert(clock != NULL);
+
+  Sint64 drift = (Sint64)clock->skew_ppm * (now - clock->best.time);
+  return clock->best.offset + (int)(drift / 1000000);
+}
+
+// ============================================================================
+
+void clock_update(Clock* clock, int now)
+{
+  SDL_assert(clock != NULL);
+
+  int elapsed = now - clock->slewed;
+  clock->slewed = now;
+  if (clock->adjust == 0 || clock->synchronized == 0) {
+    return;
+  }
+
+  // step large errors at once but slew smaller ones to keep the time monotonic.
+  int error = clock_target(clock, now) - clock->offset;
+  if (error > CLOCK_STEP_THRESHOLD || error < -CLOCK_STEP_THRESHOLD) {
+    clock->offset += error;
+    clock->steps++;
+    clock->slew_budget = 0;
+    return;
+  }
+  clock->slew_budget += elapsed;
+  int limit = clock->slew_budget / CLOCK_SLEW_RATIO;
+  clock->slew_budget -= limit * CLOCK_SLEW_RATIO;
+  clock->offset += SDL_max(-limit, SDL_min(error, limit));
+}
@@ -0,0 +1,70 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <SDL/SDL.h>
+
+// the amount of pings sent in a quick burst when the match starts.
+#define CLOCK_BURST_SIZE 8
+// the interval (ms) between the pings of the startup burst.
+#define CLOCK_BURST_INTERVAL 25
+// the amount of recent samples used for the minimum round-trip selection.
+#define CLOCK_SAMPLE_WINDOW 16
+// the minimum time span (ms) between samples before estimating the skew.
+#define CLOCK_SKEW_BASELINE 10000
+// the amount of elapsed time (ms) required to slew the offset by a millisecond.
+#define CLOCK_SLEW_RATIO 20
+// the offset error (ms) which is stepped at once instead of slewing.
+#define CLOCK_STEP_THRESHOLD 250
+
+typedef struct {
+  // the round-trip time of the sample.
+  int rtt;
+  // the remote clock minus the local clock at the sample.
+  int offset;
+  // the local time when the sample was received.
+  int time;
+} ClockSample;
+
+typedef struct {
+  // a definition whether the estimate is applied to the local clock.
+  int adjust;
+  // a definition whether the first sample has been received.
+  int synchronized;
+  // the offset (ms) currently applied to the local clock.
+  int offset;
+  // the minimum round-trip time within the sample window.
+  int rtt;
+  // the estimated drift of the remote clock in parts per million.
+  int skew_ppm;
+  // the amount of pings still to be sent in the startup burst.
+  int burst;
+  // the amount of samples received so far.
+  int samples;
+  // the amount of times the offset was stepped instead of slewed.
+  int steps;
+  // the local time of the previous slew.
+  int slewed;
+  // the elapsed time (ms) not yet converted into a slew.
+  int slew_budget;
+  // the sample with the lowest round-trip time within the window.
+  ClockSample best;
+  // the first selected sample used as the base of the skew estimate.
+  ClockSample anchor;
+  // the ring of the most recent samples.
+  ClockSample window[CLOCK_SAMPLE_WINDOW];
+} Clock;
+
+// ============================================================================
+
+// initialize the clock to start a ping burst. adjust the local clock only when requested.
+void clock_init(Clock* clock, int adjust, int now);
+// get the interval (ms) until the next ping and consume a burst ping if any.
+int clock_next_ping(Clock* clock);
+// add a sample from a ping sent at t0, answered at t1 and received at t2.
+void clock_sample(Clock* clock, int t0, int t1, int t2);
+// get the estimated offset (ms) between the remote and the local clock at the given time.
+int clock_target(const Clock* clock, int now);
+// slew the applied offset towards the estimated offset.
+void clock_update(Clock* clock, int now);
+
+#endif
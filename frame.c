@@ -0,0 +1,63 @@
+#include "frame.h"
+
+// ============================================================================
+// build the path of the numbered frame within the given directory.
+static void frame_path(char* path, const char* directory, int index)
+{
+  SDL_snprintf(path, FRAME_MAX_PATH, "%s/frame-%06d.bmp", directory, index);
+}
+
+// ============================================================================
+
+int frame_save(SDL_Surface* surface, const char* directory, int index)
+{
+  SDL_assert(surface != NULL);
+  SDL_assert(directory != NULL);
+
+  char path[FRAME_MAX_PATH];
+  frame_path(path, directory, index);
+  return (SDL_SaveBMP(surface, path) == 0 ? 0 : -1);
+}
+
+// ============================================================================
+
+int frame_compare(SDL_Surface* surface, const char* directory, int index)
+{
+  SDL_assert(surface != NULL);
+  SDL_assert(directory != NULL);
+
+  // load the golden frame and convert it into the pixel format of the surface.
+  char path[FRAME_MAX_PATH];
+  frame_path(path, directory, index);
+  SDL_Surface* loaded = SDL_LoadBMP(path);
+  if (loaded == NULL) {
+    return -1;
+  }
+  SDL_Surface* golden = SDL_ConvertSurfaceFormat(loaded, surface->format->format, 0);
+  SDL_FreeSurface(loaded);
+  if (golden == NULL) {
+    return -1;
+  }
+  if (golden->w != surface->w || golden->h != surface->h) {
+    SDL_FreeSurface(golden);
+    return surface->w * surface->h;
+  }
+
+  // count the differing pixels row by row while ignoring the unused (alpha) bits.
+  SDL_assert(surface->format->BytesPerPixel == 4);
+  Uint32 mask = surface->format->Rmask | surface->format->Gmask | surface->format->Bmask;
+  int differences = 0;
+  SDL_LockSurface(surface);
+  SDL_LockSurface(golden);
+  for (int y = 0; y < surface->h; y++) {
+    const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+    const Uint32* goldenRow = (const Uint32*)((const Uint8*)golden->pixels + y * golden->pitch);
+    for (int x = 0; x < surface->w; x++) {
+      differences += ((row[x] ^ goldenRow[x]) & mask ? 1 : 0);
+    }
+  }
+  SDL_UnlockSurface(golden);
+  SDL_UnlockSurface(surface);
+  SDL_FreeSurface(golden);
+  return differences;
+}
@@ -0,0 +1,18 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <SDL/SDL.h>
+
+// the maximum length of a frame file path.
+#define FRAME_MAX_PATH 256
+
+// ============================================================================
+
+// save the surface as the numbered BMP frame into the given directory.
+// returns -1 when the frame could not be written and zero otherwise.
+int frame_save(SDL_Surface* surface, const char* directory, int index);
+// compare the surface pixel by pixel with the numbered golden frame in the given directory.
+// returns the amount of differing pixels or -1 when the golden frame could not be read.
+int frame_compare(SDL_Surface* surface, const char* directory, int index);
+
+#endif
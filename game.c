@@ -0,0 +1,923 @@
+#include "game.h"
+#include "metrics.h"
+#include "sim.h"
+#include "trace.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// a function pointer type for handling a received network message.
+typedef void (*message_handler_func)(Match*, const Message*);
+
+// boundaries of the non-moving wall at the top of the scene.
+const SDL_Rect TOP_WALL = { 0, 0, RESOLUTION_WIDTH, BOX };
+// boundaries of the non-moving wall at the bottom of the scene.
+const SDL_Rect BOTTOM_WALL = { 0, RESOLUTION_HEIGHT - BOX, RESOLUTION_WIDTH, BOX };
+// the boundaries of the invisible left goal.
+const SDL_Rect LEFT_GOAL = { -1000, 0, (1000 - BOX), RESOLUTION_HEIGHT };
+// the boundaries of the invisible right goal.
+const SDL_Rect RIGHT_GOAL = { RESOLUTION_WIDTH + BOX, 0, 1000, RESOLUTION_HEIGHT };
+
+// the starting position of the left paddle.
+const SDL_Rect LEFT_PADDLE_START = {
+  PADDLE_EDGE_OFFSET,
+  RESOLUTION_HALF_HEIGHT - PADDLE_HALF_HEIGHT,
+  PADDLE_WIDTH,
+  PADDLE_HEIGHT
+};
+// the starting position of the right paddle.
+const SDL_Rect RIGHT_PADDLE_START = {
+  RESOLUTION_WIDTH - PADDLE_EDGE_OFFSET - BOX,
+  RESOLUTION_HALF_HEIGHT - PADDLE_HALF_HEIGHT,
+  PADDLE_WIDTH,
+  PADDLE_HEIGHT
+};
+// the starting position for the game ball.
+const SDL_Rect BALL_START = {
+  RESOLUTION_HALF_WIDTH - BOX_HALF,
+  RESOLUTION_HALF_HEIGHT - BOX_HALF,
+  BALL_WIDTH,
+  BALL_HEIGHT
+};
+
+// the netcode used to host new matches.
+static int sNetcode = NETCODE_LAG;
+// a definition whether to print the progress of the matches.
+static int sVerbose = 1;
+// the source of the local time.
+static time_source_func sTimeSource = &SDL_GetTicks;
+
+// ============================================================================
+
+static void send_message(Match* match, const Message* msg);
+static void ping_send_response(Match* match, int ping);
+static void reset_client(Match* match, int time);
+static void reset_server(Match* match, int time);
+
+// ============================================================================
+// give a point to the target player.
+static void give_point(Match* match, int player)
+{
+  SDL_assert(player >= 0);
+  SDL_assert(player <= 1);
+
+  // increment points of the target player.
+  if (sVerbose == 1) {
+    printf("A point for %s player!\n", (player == 0 ? "left" : "right"));
+  }
+  int endGame = 0;
+  if (player == 0) {
+    match->left_points++;
+    endGame = (match->left_points >= SCORE_LIMIT ? 1 : 0);
+  } else {
+    match->right_points++;
+    endGame = (match->right_points >= SCORE_LIMIT ? 1 : 0);
+  }
+
+  // check whether we should end the game.
+  if (endGame == 1) {
+    Message msg = { .type = MESSAGE_END };
+    send_message(match, &msg);
+  }
+}
+
+// ============================================================================
+// get a rect for the given time for the target object.
+SDL_Rect state_get(const Match* match, const DynamicObject* object, int time)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(object != NULL);
+
+  // state checks are only required for non-owned objects.
+  if (object->owned != 1) {
+    // apply remote lag to keep non-owned objects in the past to compensate lag.
+    return history_get(&object->history, time - match->remote_lag);
+  }
+  return history_newest(&object->history)->rect;
+}
+
+// ============================================================================
+// get a rect for rendering the target object at the given time between two ticks.
+SDL_Rect state_view(const Match* match, const DynamicObject* object, int time)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(object != NULL);
+
+  // owned objects are shown one tick behind to blend between the two newest ticks.
+  if (object->owned == 1) {
+    return history_get(&object->history, time - TIMESTEP);
+  }
+  return state_get(match, object, time);
+}
+
+// ============================================================================
+// set the given rect as a state for the given object at the given time.
+void state_set(DynamicObject* object, const SDL_Rect* rect, int time)
+{
+  SDL_assert(object != NULL);
+  SDL_assert(rect != NULL);
+  history_add(&object->history, rect, time);
+}
+
+// ============================================================================
+// set all states to given rect after the given from time point.
+void state_clear(DynamicObject* object, const SDL_Rect* rect, int from)
+{
+  SDL_assert(object != NULL);
+  SDL_assert(rect != NULL);
+  SDL_assert(from > 0);
+  history_clear(&object->history, rect, from);
+}
+
+// ============================================================================
+// send the current ball state to the remote node.
+static void ball_send(Match* match, const SDL_Rect* ball, int time)
+{
+  Message msg = {
+    .type = MESSAGE_BALL,
+    .ball = {
+      time,
+      ball->x,
+      ball->y,
+      match->ball.direction_x,
+      match->ball.direction_y,
+      match->ball.velocity
+    }
+  };
+  send_message(match, &msg);
+}
+
+// ============================================================================
+// update all game objects in a node specific way.
+static void update(Match* match, int time)
+{
+  // resolve the current position of each dynamic game object.
+  SDL_Rect left = state_get(match, &match->left_paddle, match->previous_tick);
+  SDL_Rect right = state_get(match, &match->right_paddle, match->previous_tick);
+  SDL_Rect ball = state_get(match, &match->ball, match->previous_tick);
+
+  // describe the resolved scene as a simulation state with a launched ball.
+  SimState state;
+  SDL_memset(&state, 0, sizeof(state));
+  state.left_y = sim_fixed(left.y);
+  state.right_y = sim_fixed(right.y);
+  state.ball_x = sim_fixed(ball.x);
+  state.ball_y = sim_fixed(ball.y);
+  state.ball_velocity = sim_fixed(match->ball.velocity);
+  state.ball_direction_x = match->ball.direction_x;
+  state.ball_direction_y = match->ball.direction_y;
+
+  // only the owned paddles are moved while the remote ones follow the network.
+  SimInput input = {
+    (match->left_paddle.owned == 1 ? match->left_paddle.direction_y : NONE),
+    (match->right_paddle.owned == 1 ? match->right_paddle.direction_y : NONE)
+  };
+  int events = sim_move(&state, &input, &state);
+
+  // update the local state and inform the remote node about moved paddles.
+  // resting paddles are sent as periodic keyframes to heal lost paddle messages.
+  int keyframe = snapshot_keyframe_due(&match->snapshots, time / TIMESTEP);
+  if (input.left != NONE || (keyframe == 1 && match->left_paddle.owned == 1)) {
+    left.y = sim_pixels(state.left_y);
+    state_set(&match->left_paddle, &left, time);
+    Message msg = { .type = MESSAGE_LEFT, .paddle = { time, left.x, left.y } };
+    send_message(match, &msg);
+  }
+  if (input.right != NONE || (keyframe == 1 && match->right_paddle.owned == 1)) {
+    right.y = sim_pixels(state.right_y);
+    state_set(&match->right_paddle, &right, time);
+    Message msg = { .type = MESSAGE_RIGHT, .paddle = { time, right.x, right.y } };
+    send_message(match, &msg);
+  }
+
+  // update the movement of the ball.
+  if (match->ball.velocity != 0) {
+    ball.x = sim_pixels(state.ball_x);
+    ball.y = sim_pixels(state.ball_y);
+    match->ball.direction_x = state.ball_direction_x;
+    match->ball.direction_y = state.ball_direction_y;
+    match->ball.velocity = sim_pixels(state.ball_velocity);
+
+    // the owner of the hit paddle informs the remote node about the bounce.
+    if ((events & SIM_EVENT_LEFT_PADDLE) && match->left_paddle.owned == 1) {
+      ball_send(match, &ball, time);
+    } else if ((events & SIM_EVENT_RIGHT_PADDLE) && match->right_paddle.owned == 1) {
+      ball_send(match, &ball, time);
+    }
+
+    // check whether the ball hit a goal (decide on a owner side).
+    if (match->left_paddle.owned == 1) {
+      if (events & SIM_EVENT_LEFT_GOAL) {
+        give_point(match, 1);
+        reset_server(match, time);
+        return;
+      }
+    } else {
+      if (events & SIM_EVENT_RIGHT_GOAL) {
+        Message msg = { .type = MESSAGE_GOAL };
+        send_message(match, &msg);
+        reset_client(match, time);
+        return;
+      }
+    }
+
+    // update the local state with the new position.
+    state_set(&match->ball, &ball, time);
+  }
+}
+
+// ============================================================================
+// record the message and send it to the remote node.
+static void send_message(Match* match, const Message* msg)
+{
+  if (match->recorder != NULL) {
+    record_message(match->recorder, RECORD_SENT, sTimeSource(), msg);
+  }
+  match->net_send(match, msg);
+}
+
+// ============================================================================
+// send a ping request message to the remote node.
+static void ping_send_request(Match* match)
+{
+  // use the local time to keep the samples independent from the applied offset.
+  Message msg = { .type = MESSAGE_PING, .ping = { (int)sTimeSource() } };
+  send_message(match, &msg);
+}
+
+// ============================================================================
+// send a ping response message (pong) to the remote node.
+static void ping_send_response(Match* match, int ping)
+{
+  Message msg = { .type = MESSAGE_PONG, .pong = { ping, match_ticks(match) } };
+  send_message(match, &msg);
+}
+
+// ============================================================================
+// get a random vertical direction (UP / DOWN)
+static int random_vertical_direction()
+{
+  return (rand() % 2) == 0 ? UP : DOWN;
+}
+
+// ============================================================================
+// get a random horizontal direction (LEFT / RIGHT).
+static int random_horizontal_direction()
+{
+  return (rand() % 2) == 0 ? LEFT : RIGHT;
+}
+
+// ============================================================================
+// reset the game (except points) at the client side.
+static void reset_client(Match* match, int time)
+{
+  SDL_assert(match->mode == CLIENT);
+
+  // clear all possible future states from the dynamic objects.
+  state_clear(&match->right_paddle, &RIGHT_PADDLE_START, time);
+  state_clear(&match->left_paddle, &LEFT_PADDLE_START, time);
+  state_clear(&match->ball, &BALL_START, time);
+
+  // reset dynamic objects back to their starting positions.
+  state_set(&match->right_paddle, &RIGHT_PADDLE_START, time);
+  state_set(&match->left_paddle, &LEFT_PADDLE_START, time);
+  state_set(&match->ball, &BALL_START, time);
+
+  // reset ball velocity back to initial velocity.
+  match->ball.velocity = BALL_INITIAL_VELOCITY;
+}
+
+// ============================================================================
+// reset the game (except points) at the server side.
+static void reset_server(Match* match, int time)
+{
+  SDL_assert(match->mode == SERVER);
+
+  // clear all possible future states from the dynamic objects.
+  state_clear(&match->right_paddle, &RIGHT_PADDLE_START, time);
+  state_clear(&match->left_paddle, &LEFT_PADDLE_START, time);
+  state_clear(&match->ball, &BALL_START, time);
+
+  // reset dynamic objects back to their starting positions.
+  state_set(&match->right_paddle, &RIGHT_PADDLE_START, time);
+  state_set(&match->left_paddle, &LEFT_PADDLE_START, time);
+  state_set(&match->ball, &BALL_START, time);
+
+  // reset ball velocity back to initial velocity.
+  match->ball.velocity = BALL_INITIAL_VELOCITY;
+
+  // assign a countdown to prevent ball from launching immediately.
+  match->countdown = time + COUNTDOWN_MS;
+
+  // randomize new horizontal- and vertical directions for the ball.
+  match->ball.direction_x = random_horizontal_direction();
+  match->ball.direction_y = random_vertical_direction();
+
+  // send the reset command to client as well.
+  Message msg = {
+    .type = MESSAGE_RESET,
+    .reset = {
+      time, match->countdown, match->ball.direction_x, match->ball.direction_y,
+      match->left_points, match->right_points
+    }
+  };
+  send_message(match, &msg);
+}
+
+// ============================================================================
+// take the ownership of all objects when they are simulated locally.
+static void own_objects(Match* match)
+{
+  // locally simulated objects are never shown in the past.
+  match->left_paddle.owned = 1;
+  match->right_paddle.owned = 1;
+  match->ball.owned = 1;
+  match->countdown = 0;
+}
+
+// ============================================================================
+// show the given simulation state with the dynamic objects of the match.
+static void show_state(Match* match, const SimState* state, int time)
+{
+  SDL_Rect left = LEFT_PADDLE_START;
+  SDL_Rect right = RIGHT_PADDLE_START;
+  SDL_Rect ball = BALL_START;
+  left.y = sim_pixels(state->left_y);
+  right.y = sim_pixels(state->right_y);
+  ball.x = sim_pixels(state->ball_x);
+  ball.y = sim_pixels(state->ball_y);
+  state_set(&match->left_paddle, &left, time);
+  state_set(&match->right_paddle, &right, time);
+  state_set(&match->ball, &ball, time);
+  match->left_points = state->left_points;
+  match->right_points = state->right_points;
+}
+
+// ============================================================================
+// end the match at the server when the given state has reached the score limit.
+static void end_on_limit(Match* match, const SimState* state)
+{
+  // the end is sent only once as the control messages are delivered reliably.
+  if (match->mode == SERVER && match->end_sent == 0) {
+    if (state->left_points >= SCORE_LIMIT || state->right_points >= SCORE_LIMIT) {
+      Message msg = { .type = MESSAGE_END };
+      send_message(match, &msg);
+      match->end_sent = 1;
+    }
+  }
+}
+
+// ============================================================================
+// start playing the match with rollback netcode from the given time.
+static void rollback_start(Match* match, int time, Uint32 seed)
+{
+  rollback_init(&match->rollback, (match->mode == SERVER ? 0 : 1), time, seed);
+  own_objects(match);
+}
+
+// ============================================================================
+// send the local inputs ending at the given frame to the remote node.
+static void rollback_send_inputs(Match* match, int frame)
+{
+  Message msg = {
+    .type = MESSAGE_INPUT,
+    .input = {
+      frame,
+      rollback_local_inputs(&match->rollback, frame),
+      match->rollback.confirmed
+    }
+  };
+  send_message(match, &msg);
+}
+
+// ============================================================================
+// advance the rollback simulation up to the given time and show its state.
+static void rollback_update(Match* match, int time)
+{
+  Rollback* rollback = &match->rollback;
+
+  // re-simulate the frames with mispredicted remote inputs.
+  rollback_resolve(rollback);
+
+  // simulate all frames up to now with the current local input.
+  const DynamicObject* paddle = (rollback->side == 0 ? &match->left_paddle : &match->right_paddle);
+  int target = rollback_frame_at(rollback, time);
+  while (rollback->frame <= target && rollback_can_advance(rollback)) {
+    rollback_advance(rollback, paddle->direction_y);
+  }
+
+  // send the newest inputs and resend the oldest ones not yet acknowledged.
+  if (rollback->frame > 0) {
+    rollback_send_inputs(match, rollback->frame - 1);
+    if (rollback->remote_ack < rollback->frame - ROLLBACK_INPUT_HISTORY) {
+      rollback_send_inputs(match, rollback->remote_ack + ROLLBACK_INPUT_HISTORY - 1);
+    }
+  }
+
+  // show the most recent (predicted) state and end only with known inputs.
+  show_state(match, rollback_state(rollback), time);
+  end_on_limit(match, rollback_confirmed_state(rollback));
+}
+
+// ============================================================================
+// send the state as a delta against the newest state acknowledged by the client.
+static void snapshot_send(Match* match, const SimState* state, int input)
+{
+  Snapshots* snapshots = &match->snapshots;
+  snapshot_store(snapshots, state);
+
+  // fall back to a keyframe when the baseline is not available or one is due.
+  const SimState* base = snapshot_find(snapshots, snapshots->acked);
+  int tick = (int)state->tick;
+  if (snapshot_keyframe_due(snapshots, tick) == 1) {
+    base = NULL;
+  } else if (base == NULL) {
+    snapshots->keyframe = tick;
+  }
+
+  Message msg = { .type = MESSAGE_SNAPSHOT };
+  msg.snapshot.ack = match->prediction.acked;
+  msg.snapshot.input = input;
+  msg.snapshot.tick = tick;
+  msg.snapshot.base = (base == NULL ? 0 : tick - (int)base->tick);
+  msg.snapshot.length = snapshot_encode(base, state, msg.snapshot.data, PROTOCOL_MAX_SNAPSHOT_DATA);
+  SDL_assert(msg.snapshot.length >= 0);
+  send_message(match, &msg);
+
+  // collect the statistics of the sent snapshots.
+  snapshots->keyframes += (base == NULL ? 1 : 0);
+  snapshots->deltas += (base == NULL ? 0 : 1);
+  snapshots->bytes += msg.snapshot.length;
+}
+
+// ============================================================================
+// start playing the match with client-side prediction.
+static void prediction_start(Match* match, Uint32 seed)
+{
+  prediction_init(&match->prediction, seed);
+  own_objects(match);
+}
+
+// ============================================================================
+// run the authoritative (server) or predicted (client) step and show its state.
+static void prediction_update(Match* match, int time)
+{
+  Prediction* prediction = &match->prediction;
+  if (match->mode == SERVER) {
+    // simulate and send the authoritative state along with the processed input.
+    int input = match->left_paddle.direction_y;
+    prediction_server_step(prediction, input);
+    const SimState* state = &prediction->state;
+    snapshot_send(match, state, input);
+    show_state(match, state, time);
+    end_on_limit(match, state);
+  } else {
+    // predict the outcome of the local input and send it to the server.
+    int sequence = prediction_client_step(prediction, match->right_paddle.direction_y);
+    Message msg = {
+      .type = MESSAGE_INPUT,
+      .input = {
+        sequence,
+        prediction_client_inputs(prediction, sequence),
+        match->snapshots.acked
+      }
+    };
+    send_message(match, &msg);
+
+    // show the prediction with the smoothed visual offsets of the corrections.
+    SimState shown = prediction->state;
+    shown.left_y += prediction->left_offset;
+    shown.right_y += prediction->right_offset;
+    shown.ball_x += prediction->ball_offset_x;
+    shown.ball_y += prediction->ball_offset_y;
+    show_state(match, &shown, time);
+  }
+}
+
+// ============================================================================
+// handle a quit message from the remote node.
+static void handle_quit(Match* match, const Message* msg)
+{
+  (void)msg;
+  if (sVerbose == 1) {
+    printf("Remote node has closed the connection: Closing application...\n");
+  }
+  match->state = STOPPED;
+}
+
+// ============================================================================
+// handle a ping request message from the remote node.
+static void handle_ping(Match* match, const Message* msg)
+{
+  // send a pong response back to requester.
+  ping_send_response(match, msg->ping.time);
+}
+
+// ============================================================================
+// handle a ping response message from the remote node.
+static void handle_pong(Match* match, const Message* msg)
+{
+  // get ping and pong times.
+  int t0 = msg->pong.ping;
+  int t1 = msg->pong.pong;
+
+  // feed the clock estimator and base the remote lag on its filtered latency.
+  int t2 = sTimeSource();
+  clock_sample(&match->clock, t0, t1, t2);
+  metrics_observe(METRIC_RTT, t2 - t0);
+  metrics_set(METRIC_CLOCK_OFFSET, match->clock.offset);
+  metrics_set(METRIC_CLOCK_SKEW, match->clock.skew_ppm);
+  int rtt = match->clock.rtt;
+  int lag = (rtt / 2);
+  match->remote_lag = lag + (50 - (lag % 50));
+
+  // keep enough history to cover the remote lag and the age of remote updates.
+  int depth = (match->remote_lag + rtt) / TIMESTEP + HISTORY_MIN_DEPTH;
+  history_set_depth(&match->left_paddle.history, depth);
+  history_set_depth(&match->right_paddle.history, depth);
+  history_set_depth(&match->ball.history, depth);
+  if (sVerbose == 0) {
+    return;
+  }
+  if (match->mode == SERVER) {
+    printf("rtt:%d remoteLag:%d\n", rtt, match->remote_lag);
+  } else {
+    printf("rtt:%d remoteLag:%d offset:%d target:%d skew:%dppm\n", rtt, match->remote_lag,
+      match->clock.offset, clock_target(&match->clock, t2), match->clock.skew_ppm);
+  }
+}
+
+// ============================================================================
+// handle a left paddle state message from the remote node.
+static void handle_left(Match* match, const Message* msg)
+{
+  // create a new state and assign it to states array.
+  SDL_Rect rect = {msg->paddle.x, msg->paddle.y, PADDLE_WIDTH, PADDLE_HEIGHT };
+  state_set(&match->left_paddle, &rect, msg->paddle.time);
+}
+
+// ============================================================================
+// handle a right paddle state message from the remote node.
+static void handle_right(Match* match, const Message* msg)
+{
+  // create a new state and assign it to states array.
+  SDL_Rect rect = {msg->paddle.x, msg->paddle.y, PADDLE_WIDTH, PADDLE_HEIGHT };
+  state_set(&match->right_paddle, &rect, msg->paddle.time);
+}
+
+// ============================================================================
+// handle a ball state message from the remote node.
+static void handle_ball(Match* match, const Message* msg)
+{
+  // a delayed ball state from before the latest reset belongs to a finished rally and
+  // would move the ball back behind a goal which was already scored.
+  int t = msg->ball.time;
+  if (t < match->countdown) {
+    return;
+  }
+
+  // check if we need to correct the position and direction of the ball.
+  SDL_Rect rect = {msg->ball.x, msg->ball.y, BALL_WIDTH, BALL_HEIGHT };
+  SDL_Rect usedRect = state_get(match, &match->ball, t);
+  if (usedRect.x != rect.x || usedRect.y != rect.y
+    || msg->ball.direction_x != match->ball.direction_x
+    || msg->ball.direction_y != match->ball.direction_y
+    || msg->ball.velocity != match->ball.velocity) {
+    metrics_observe(METRIC_BALL_CORRECTION,
+      SDL_max(abs(usedRect.x - rect.x), abs(usedRect.y - rect.y)));
+    state_clear(&match->ball, &rect, t);
+    state_set(&match->ball, &rect, t);
+    match->ball.direction_x = msg->ball.direction_x;
+    match->ball.direction_y = msg->ball.direction_y;
+    match->ball.velocity = msg->ball.velocity;
+  }
+}
+
+// ============================================================================
+// handle a reset message from the server.
+static void handle_reset(Match* match, const Message* msg)
+{
+  SDL_assert(match->mode == CLIENT);
+
+  // assign countdown, ball directions and points.
+  match->countdown = msg->reset.countdown;
+  match->ball.direction_x = msg->reset.direction_x;
+  match->ball.direction_y = msg->reset.direction_y;
+  match->left_points = msg->reset.left_points;
+  match->right_points = msg->reset.right_points;
+
+  // perform a client reset.
+  reset_client(match, msg->reset.time);
+}
+
+// ============================================================================
+// handle a goal message from the client.
+static void handle_goal(Match* match, const Message* msg)
+{
+  (void)msg;
+  SDL_assert(match->mode == SERVER);
+  give_point(match, 0);
+  reset_server(match, match_ticks(match));
+}
+
+// ============================================================================
+// handle a game end message from the server.
+static void handle_end(Match* match, const Message* msg)
+{
+  (void)msg;
+  SDL_assert(match->mode == CLIENT);
+  match->end_countdown = sTimeSource() + END_COUNTDOWN_MS;
+  Message response = { .type = MESSAGE_END_OK };
+  send_message(match, &response);
+}
+
+// ============================================================================
+// handle a game end acknowledgement message from the client.
+static void handle_end_ok(Match* match, const Message* msg)
+{
+  (void)msg;
+  SDL_assert(match->mode == SERVER);
+  match->end_countdown = sTimeSource() + END_COUNTDOWN_MS;
+}
+
+// ============================================================================
+// handle a rollback match start message from the server.
+static void handle_start(Match* match, const Message* msg)
+{
+  SDL_assert(match->mode == CLIENT);
+  if (match->rollback.enabled == 0) {
+    if (sVerbose == 1) {
+      printf("Server requested rollback netcode: Starting frame sync...\n");
+    }
+    rollback_start(match, msg->start.time, (Uint32)msg->start.seed);
+  }
+}
+
+// ============================================================================
+// handle the rollback inputs of the remote player or the predicted client inputs.
+static void handle_input(Match* match, const Message* msg)
+{
+  if (match->rollback.enabled == 1) {
+    rollback_receive(&match->rollback, msg->input.frame, msg->input.inputs, msg->input.ack);
+  } else if (match->prediction.enabled == 1 && match->mode == SERVER) {
+    prediction_receive(&match->prediction, msg->input.frame, msg->input.inputs);
+
+    // the client acknowledges its newest received state or requests a keyframe with -1.
+    Snapshots* snapshots = &match->snapshots;
+    if (msg->input.ack < 0 || msg->input.ack > snapshots->acked) {
+      snapshots->acked = msg->input.ack;
+    }
+  }
+}
+
+// ============================================================================
+// handle an authoritative state from the server for the client-side prediction.
+static void handle_snapshot(Match* match, const Message* msg)
+{
+  SDL_assert(match->mode == CLIENT);
+
+  // request a keyframe when the baseline of the delta is no longer available.
+  Snapshots* snapshots = &match->snapshots;
+  const SimState* base = NULL;
+  if (msg->snapshot.base > 0) {
+    base = snapshot_find(snapshots, msg->snapshot.tick - msg->snapshot.base);
+    if (base == NULL) {
+      metrics_add(METRIC_KEYFRAME_REQUESTS, 1);
+      snapshots->acked = -1;
+      return;
+    }
+  }
+
+  SimState state;
+  if (snapshot_decode(base, msg->snapshot.data, msg->snapshot.length, &state) < 0) {
+    printf("Received a malformed snapshot: Requesting a keyframe...\n");
+    metrics_add(METRIC_KEYFRAME_REQUESTS, 1);
+    snapshots->acked = -1;
+    return;
+  }
+  state.tick = (Uint32)msg->snapshot.tick;
+  snapshot_store(snapshots, &state);
+  snapshots->acked = SDL_max(snapshots->acked, msg->snapshot.tick);
+  snapshots->keyframes += (base == NULL ? 1 : 0);
+  snapshots->deltas += (base == NULL ? 0 : 1);
+  snapshots->bytes += msg->snapshot.length;
+
+  if (match->prediction.enabled == 0) {
+    if (sVerbose == 1) {
+      printf("Server requested client-side prediction: Starting reconciliation...\n");
+    }
+    prediction_start(match, state.seed);
+  }
+  prediction_reconcile(&match->prediction, &state, msg->snapshot.ack, msg->snapshot.input);
+}
+
+// the message handlers indexed by the message type (opcode).
+static const message_handler_func MESSAGE_HANDLERS[MESSAGE_TYPE_COUNT] = {
+  [MESSAGE_HELLO] = NULL,
+  [MESSAGE_QUIT] = &handle_quit,
+  [MESSAGE_PING] = &handle_ping,
+  [MESSAGE_PONG] = &handle_pong,
+  [MESSAGE_LEFT] = &handle_left,
+  [MESSAGE_RIGHT] = &handle_right,
+  [MESSAGE_BALL] = &handle_ball,
+  [MESSAGE_RESET] = &handle_reset,
+  [MESSAGE_GOAL] = &handle_goal,
+  [MESSAGE_END] = &handle_end,
+  [MESSAGE_END_OK] = &handle_end_ok,
+  [MESSAGE_START] = &handle_start,
+  [MESSAGE_INPUT] = &handle_input,
+  [MESSAGE_SNAPSHOT] = &handle_snapshot
+};
+
+
+// ============================================================================
+
+void match_set_netcode(int netcode)
+{
+  SDL_assert(netcode >= NETCODE_LAG && netcode <= NETCODE_PREDICT);
+  sNetcode = netcode;
+}
+
+// ============================================================================
+
+int match_get_netcode()
+{
+  return sNetcode;
+}
+
+// ============================================================================
+
+void match_set_verbose(int verbose)
+{
+  sVerbose = verbose;
+}
+
+// ============================================================================
+
+int match_get_verbose()
+{
+  return sVerbose;
+}
+
+// ============================================================================
+
+void match_set_time_source(time_source_func source)
+{
+  SDL_assert(source != NULL);
+  sTimeSource = source;
+}
+
+// ============================================================================
+
+time_source_func match_get_time_source()
+{
+  return sTimeSource;
+}
+
+// ============================================================================
+
+void match_init(Match* match, int mode, net_send_func send, void* connection)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(send != NULL);
+
+  match->mode = mode;
+  match->state = RUNNING;
+  match->previous_tick = 0;
+  match->next_ping_ticks = 0;
+  match->remote_lag = 0;
+  match->countdown = 0;
+  match->end_countdown = INT_MAX;
+  match->end_sent = 0;
+  match->left_points = 0;
+  match->right_points = 0;
+  match->net_send = send;
+  match->connection = connection;
+  match->recorder = NULL;
+  match->rollback.enabled = 0;
+  match->prediction.enabled = 0;
+  snapshot_init(&match->snapshots);
+  clock_init(&match->clock, (mode == CLIENT ? 1 : 0), sTimeSource());
+
+  // initialize the paddle show at the left side of the scene.
+  match->left_paddle.owned = (mode == SERVER ? 1 : 0);
+  match->left_paddle.direction_x = NONE;
+  match->left_paddle.direction_y = NONE;
+  match->left_paddle.velocity = PADDLE_VELOCITY;
+  history_init(&match->left_paddle.history, &LEFT_PADDLE_START, HISTORY_MIN_DEPTH);
+
+  // initialize the paddle show at the right side of the scene.
+  match->right_paddle.owned = (mode == CLIENT ? 1 : 0);
+  match->right_paddle.direction_x = NONE;
+  match->right_paddle.direction_y = NONE;
+  match->right_paddle.velocity = PADDLE_VELOCITY;
+  history_init(&match->right_paddle.history, &RIGHT_PADDLE_START, HISTORY_MIN_DEPTH);
+
+  // initialize the ball to start from the middle of the scene.
+  match->ball.owned = 1;
+  match->ball.direction_x = NONE;
+  match->ball.direction_y = NONE;
+  match->ball.velocity = BALL_INITIAL_VELOCITY;
+  history_init(&match->ball.history, &BALL_START, HISTORY_MIN_DEPTH);
+}
+
+// ============================================================================
+
+void match_start(Match* match)
+{
+  SDL_assert(match != NULL);
+  if (match->recorder != NULL) {
+    record_event(match->recorder, RECORD_START, sTimeSource(), NULL, 0);
+  }
+
+  // start with a quick ping burst to synchronize the clocks.
+  ping_send_request(match);
+  match->next_ping_ticks = sTimeSource() + clock_next_ping(&match->clock);
+  if (match->mode == SERVER && sNetcode == NETCODE_ROLLBACK) {
+    // let the client synchronize its clock before the first frame.
+    Message msg = {
+      .type = MESSAGE_START,
+      .start = { match_ticks(match) + ROLLBACK_START_DELAY, rand() }
+    };
+    rollback_start(match, msg.start.time, (Uint32)msg.start.seed);
+    send_message(match, &msg);
+  } else if (match->mode == SERVER && sNetcode == NETCODE_PREDICT) {
+    prediction_start(match, (Uint32)rand());
+  } else if (match->mode == SERVER) {
+    reset_server(match, sTimeSource());
+  }
+}
+
+// ============================================================================
+
+void match_poll(Match* match)
+{
+  SDL_assert(match != NULL);
+
+  // check whether it's time to end the game.
+  int ticks = sTimeSource();
+  if (match->recorder != NULL) {
+    record_event(match->recorder, RECORD_POLL, ticks, NULL, 0);
+  }
+  if (match->end_countdown <= ticks) {
+    match->state = STOPPED;
+    return;
+  }
+
+  // send ping request with the predefined interval.
+  if (match->next_ping_ticks <= ticks) {
+    ping_send_request(match);
+    match->next_ping_ticks = ticks + clock_next_ping(&match->clock);
+  }
+
+  // move the clock offset gradually towards the estimate.
+  clock_update(&match->clock, ticks);
+}
+
+// ============================================================================
+
+void match_update(Match* match, int time)
+{
+  SDL_assert(match != NULL);
+  if (match->recorder != NULL) {
+    const DynamicObject* paddle = (match->mode == SERVER ? &match->left_paddle : &match->right_paddle);
+    record_update(match->recorder, sTimeSource(), time, paddle->direction_y);
+  }
+
+  // the simulation based netcodes handle the countdowns by themselves.
+  if (match->rollback.enabled == 1) {
+    rollback_update(match, time);
+  } else if (match->prediction.enabled == 1) {
+    prediction_update(match, time);
+  } else if (match->countdown <= time) {
+    update(match, time);
+  }
+}
+
+// ============================================================================
+
+void match_dispatch(Match* match, const Message* msg)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(msg != NULL);
+  SDL_assert(msg->type >= 0 && msg->type < MESSAGE_TYPE_COUNT);
+  if (match->recorder != NULL) {
+    record_message(match->recorder, RECORD_RECEIVED, sTimeSource(), msg);
+  }
+
+  message_handler_func handler = MESSAGE_HANDLERS[msg->type];
+  if (handler != NULL) {
+    Uint64 traced = trace_begin();
+    handler(match, msg);
+    trace_end("handler", protocol_get_name(msg->type), traced);
+  }
+}
+
+// ============================================================================
+
+int match_ticks(const Match* match)
+{
+  SDL_assert(match != NULL);
+  return sTimeSource() + match->clock.offset;
+}
@@ -0,0 +1,205 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <SDL/SDL.h>
+
+#include "protocol.h"
+#include "clock.h"
+#include "history.h"
+#include "predict.h"
+#include "record.h"
+#include "rollback.h"
+#include "snapshot.h"
+
+// game resolution width in pixels.
+#define RESOLUTION_WIDTH 800
+// game resolution height in pixels.
+#define RESOLUTION_HEIGHT 600
+
+// game resolution width divided by two.
+#define RESOLUTION_HALF_WIDTH (RESOLUTION_WIDTH / 2)
+// game resolution height divided by two.
+#define RESOLUTION_HALF_HEIGHT (RESOLUTION_HEIGHT / 2)
+
+// the network port used by the application.
+#define NETWORK_PORT 6666
+// the network message buffer size.
+#define NETWORK_BUFFER_SIZE 512
+// the interval to send ping requests.
+#define NETWORK_PING_INTERVAL 1000
+// the maximum payload of a single UDP packet that avoids IP fragmentation.
+#define NETWORK_MTU 508
+// the amount of preallocated packets used to receive UDP data.
+#define NETWORK_PACKET_POOL_SIZE 16
+// the time (ms) to wait for the server to acknowledge the UDP hello message.
+#define NETWORK_CONNECT_TIMEOUT 5000
+// the time (ms) to wait for the remote node to acknowledge the UDP quit message.
+#define NETWORK_LINGER_TIME 500
+
+// the size of a single graphical block in the scene.
+#define BOX (RESOLUTION_HEIGHT / 30)
+// the size of the single graphical block divided by two.
+#define BOX_HALF (BOX / 2)
+
+// the interval which is used to tick game logics.
+#define TIMESTEP 17
+// the amount of milliseconds to wait before each ball launch.
+#define COUNTDOWN_MS 2000
+// the amount of milliseconds to wait before ending the game.
+#define END_COUNTDOWN_MS 2000
+// the target score limit.
+#define SCORE_LIMIT 10
+
+// the height for both paddles at the sides of the scene.
+#define PADDLE_HEIGHT (RESOLUTION_HEIGHT / 6)
+// the height for both paddles divided by two.
+#define PADDLE_HALF_HEIGHT (PADDLE_HEIGHT / 2)
+// the width for both paddles at the sides of the scene.
+#define PADDLE_WIDTH BOX
+// the amount of offset between paddle and the side of the scene.
+#define PADDLE_EDGE_OFFSET (RESOLUTION_HEIGHT / 20)
+// the movement velocity for the paddles.
+#define PADDLE_VELOCITY (RESOLUTION_WIDTH / 100)
+
+// the width of the ball.
+#define BALL_WIDTH BOX
+// the height of the ball.
+#define BALL_HEIGHT BOX
+// the initial velocity for the ball.
+#define BALL_INITIAL_VELOCITY (RESOLUTION_HEIGHT / 300)
+// the amount of velocity to increase on each ball-paddle hit.
+#define BALL_VELOCITY_INCREMENT 1
+
+// available network node modes.
+enum Mode { CLIENT, SERVER };
+// available application states.
+enum State { RUNNING, STOPPED };
+// available dynamic object movement directions.
+enum Direction { UP = -1, DOWN = 1, LEFT = -1, RIGHT = 1, NONE = 0 };
+// available network transport modes.
+enum Transport { TCP, UDP, NETSIM };
+// available latency compensation mechanisms.
+enum Netcode { NETCODE_LAG, NETCODE_ROLLBACK, NETCODE_PREDICT };
+
+// ============================================================================
+
+typedef struct Match Match;
+
+// a function pointer type for sending messages over the network.
+typedef void (*net_send_func)(Match*, const Message*);
+// a function pointer type for reading the local time (ms).
+typedef Uint32 (*time_source_func)(void);
+
+// ============================================================================
+
+typedef struct {
+  // the timestamp ordered history of dynamic object states.
+  History history;
+  // a definition whether the current node owns the object.
+  int owned;
+  // the movement speed.
+  int velocity;
+  // the movement direction in x-axis.
+  int direction_x;
+  // the movement direction in y-axis.
+  int direction_y;
+} DynamicObject;
+
+struct Match {
+  // the network mode (client/server) of the local node.
+  int mode;
+  // the state of the match.
+  int state;
+  // the time (with offset) of the previous tick.
+  int previous_tick;
+  // the estimator used to synchronize clocks among nodes.
+  Clock clock;
+  // the definition when to send next ping request.
+  int next_ping_ticks;
+  // the remote lag used to compensate latency.
+  int remote_lag;
+  // the countdown time used to detect when ball should be launched.
+  int countdown;
+  // the countdown time when the game ends and exits.
+  int end_countdown;
+  // a definition whether the server has sent the end message.
+  int end_sent;
+  // the server's paddle shown at the left side of the scene.
+  DynamicObject left_paddle;
+  // the client's paddle shown at the right side of the scene.
+  DynamicObject right_paddle;
+  // the ball moving across the scene.
+  DynamicObject ball;
+  // the points of the left player.
+  int left_points;
+  // the points of the right player.
+  int right_points;
+  // a function pointer to a function to send data to remote node.
+  net_send_func net_send;
+  // the transport specific connection to the remote node.
+  void* connection;
+  // the rollback state used when the match is played with rollback netcode.
+  Rollback rollback;
+  // the prediction state used when the match is played with client-side prediction.
+  Prediction prediction;
+  // the sent (server) or received (client) states used as delta baselines.
+  Snapshots snapshots;
+  // the recorder of the match events (NULL when not recorded).
+  Recorder* recorder;
+};
+
+// ============================================================================
+
+// boundaries of the non-moving wall at the top of the scene.
+extern const SDL_Rect TOP_WALL;
+// boundaries of the non-moving wall at the bottom of the scene.
+extern const SDL_Rect BOTTOM_WALL;
+// the boundaries of the invisible left goal.
+extern const SDL_Rect LEFT_GOAL;
+// the boundaries of the invisible right goal.
+extern const SDL_Rect RIGHT_GOAL;
+// the starting position of the left paddle.
+extern const SDL_Rect LEFT_PADDLE_START;
+// the starting position of the right paddle.
+extern const SDL_Rect RIGHT_PADDLE_START;
+// the starting position for the game ball.
+extern const SDL_Rect BALL_START;
+
+// ============================================================================
+
+// select the netcode (see Netcode) used to host new matches (server only).
+void match_set_netcode(int netcode);
+// get the netcode (see Netcode) used to host new matches.
+int match_get_netcode();
+// select whether to print the progress (points, round-trip times) of the matches.
+void match_set_verbose(int verbose);
+// get whether to print the progress of the matches.
+int match_get_verbose();
+// select the source of the local time used by the matches (SDL_GetTicks by default).
+void match_set_time_source(time_source_func source);
+// get the source of the local time used by the matches.
+time_source_func match_get_time_source();
+
+// initialize the match into its starting state for the given node mode.
+void match_init(Match* match, int mode, net_send_func send, void* connection);
+// start the match after the remote node has been connected.
+void match_start(Match* match);
+// run the periodic match logics (end detection and pings).
+void match_poll(Match* match);
+// update all game objects of the match with a single fixed timestep.
+void match_update(Match* match, int time);
+// dispatch the received message to the handler of the message type.
+void match_dispatch(Match* match, const Message* msg);
+// get the current tick time of the match along with the clock offset.
+int match_ticks(const Match* match);
+
+// get a rect for the given time for the target object.
+SDL_Rect state_get(const Match* match, const DynamicObject* object, int time);
+// get a rect for rendering the target object at the given time between two ticks.
+SDL_Rect state_view(const Match* match, const DynamicObject* object, int time);
+// set the given rect as a state for the given object at the given time.
+void state_set(DynamicObject* object, const SDL_Rect* rect, int time);
+// set all states to given rect after the given from time point.
+void state_clear(DynamicObject* object, const SDL_Rect* rect, int from);
+
+#endif
@@ -0,0 +1,143 @@
+#include "history.h"
+
+// ============================================================================
+// get the state at the given position counted from the oldest state.
+static State* at(History* history, int position)
+{
+  return &history->states[(history->head + position) % HISTORY_MAX_DEPTH];
+}
+
+// ============================================================================
+// get the state at the given position counted from the oldest state.
+static const State* const_at(const History* history, int position)
+{
+  return &history->states[(history->head + position) % HISTORY_MAX_DEPTH];
+}
+
+// ============================================================================
+// find the position of the first state that is newer than the given time.
+static int upper_bound(const History* history, int time)
+{
+  int low = 0;
+  int high = history->count;
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    if (const_at(history, middle)->time <= time) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// ============================================================================
+// interpolate linearly between the values with the given fraction.
+static int lerp(int from, int to, int numerator, int denominator)
+{
+  return from + (int)(((Sint64)(to - from) * numerator) / denominator);
+}
+
+// ============================================================================
+
+void history_init(History* history, const SDL_Rect* rect, int depth)
+{
+  SDL_assert(history != NULL);
+  SDL_assert(rect != NULL);
+
+  history->head = 0;
+  history->count = 1;
+  history->depth = SDL_max(HISTORY_MIN_DEPTH, SDL_min(depth, HISTORY_MAX_DEPTH));
+  history->states[0].time = 0;
+  history->states[0].rect = *rect;
+}
+
+// ============================================================================
+
+void history_set_depth(History* history, int depth)
+{
+  SDL_assert(history != NULL);
+
+  history->depth = SDL_max(HISTORY_MIN_DEPTH, SDL_min(depth, HISTORY_MAX_DEPTH));
+  while (history->count > history->depth) {
+    history->head = (history->head + 1) % HISTORY_MAX_DEPTH;
+    history->count--;
+  }
+}
+
+// ============================================================================
+
+void history_add(History* history, const SDL_Rect* rect, int time)
+{
+  SDL_assert(history != NULL);
+  SDL_assert(rect != NULL);
+
+  // make room by dropping the oldest state when the ring is full.
+  if (history->count >= history->depth) {
+    if (time < const_at(history, 0)->time) {
+      return;
+    }
+    history->head = (history->head + 1) % HISTORY_MAX_DEPTH;
+    history->count--;
+  }
+
+  // shift the newer states (e.g. reordered packets) to keep the time order.
+  int position = upper_bound(history, time);
+  for (int i = history->count; i > position; i--) {
+    *at(history, i) = *at(history, i - 1);
+  }
+  at(history, position)->time = time;
+  at(history, position)->rect = *rect;
+  history->count++;
+}
+
+// ============================================================================
+
+void history_clear(History* history, const SDL_Rect* rect, int from)
+{
+  SDL_assert(history != NULL);
+  SDL_assert(rect != NULL);
+
+  // drop all newer states and replace them with a single state.
+  while (history->count > 0 && history_newest(history)->time >= from) {
+    history->count--;
+  }
+  history_add(history, rect, from);
+}
+
+// ============================================================================
+
+const State* history_newest(const History* history)
+{
+  SDL_assert(history != NULL);
+  SDL_assert(history->count > 0);
+  return const_at(history, history->count - 1);
+}
+
+// ============================================================================
+
+SDL_Rect history_get(const History* history, int time)
+{
+  SDL_assert(history != NULL);
+  SDL_assert(history->count > 0);
+
+  // use the boundary states when the time is outside of the history.
+  int position = upper_bound(history, time);
+  if (position == 0) {
+    return const_at(history, 0)->rect;
+  } else if (position == history->count) {
+    return history_newest(history)->rect;
+  }
+
+  // interpolate between the surrounding states.
+  const State* previous = const_at(history, position - 1);
+  const State* next = const_at(history, position);
+  int elapsed = time - previous->time;
+  int duration = next->time - previous->time;
+  SDL_Rect rect = previous->rect;
+  if (duration > 0) {
+    rect.x = lerp(previous->rect.x, next->rect.x, elapsed, duration);
+    rect.y = lerp(previous->rect.y, next->rect.y, elapsed, duration);
+  }
+  return rect;
+}
@@ -0,0 +1,44 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <SDL/SDL.h>
+
+// the maximum amount of states kept in a single history ring.
+#define HISTORY_MAX_DEPTH 128
+// the minimum amount of states kept in a single history ring.
+#define HISTORY_MIN_DEPTH 10
+
+typedef struct {
+  // the timestamp of the state.
+  int time;
+  // the rect of the state.
+  SDL_Rect rect;
+} State;
+
+typedef struct {
+  // the ring of states ordered by their timestamps.
+  State states[HISTORY_MAX_DEPTH];
+  // the index of the oldest state in the ring.
+  int head;
+  // the amount of states in the ring.
+  int count;
+  // the maximum amount of states currently kept in the ring.
+  int depth;
+} History;
+
+// ============================================================================
+
+// initialize the history to contain only the given rect at time zero.
+void history_init(History* history, const SDL_Rect* rect, int depth);
+// change the amount of kept states by dropping the oldest ones when required.
+void history_set_depth(History* history, int depth);
+// add the rect as a state at the given time into the timestamp ordered ring.
+void history_add(History* history, const SDL_Rect* rect, int time);
+// replace all states starting from the given time with the given rect.
+void history_clear(History* history, const SDL_Rect* rect, int from);
+// get the most recent state from the history.
+const State* history_newest(const History* history);
+// get the rect at the given time interpolated between the surrounding states.
+SDL_Rect history_get(const History* history, int time);
+
+#endif
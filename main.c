@@ -1,65 +1,22 @@
 #include <SDL/SDL.h>
 #include <SDL/SDL_net.h>
 
+#include "bot.h"
+#include "channel.h"
+#include "frame.h"
+#include "game.h"
+#include "metrics.h"
+#include "netsim.h"
+#include "protocol.h"
+#include "ring.h"
+#include "server.h"
+#include "trace.h"
+
 #include <stdio.h>
 #include <stdlib.h>
-#include <limits.h>
 #include <string.h>
 #include <time.h>
 
-// game resolution width in pixels.
-#define RESOLUTION_WIDTH 800
-// game resolution height in pixels.
-#define RESOLUTION_HEIGHT 600
-
-// game resolution width divided by two.
-#define RESOLUTION_HALF_WIDTH (RESOLUTION_WIDTH / 2)
-// game resolution height divided by two.
-#define RESOLUTION_HALF_HEIGHT (RESOLUTION_HEIGHT / 2)
-
-// the network port used by the application.
-#define NETWORK_PORT 6666
-// the network message buffer size.
-#define NETWORK_BUFFER_SIZE 512
-// the interval to send ping requests.
-#define NETWORK_PING_INTERVAL 1000
-
-// the size of a single graphical block in the scene.
-#define BOX (RESOLUTION_HEIGHT / 30)
-// the size of the single graphical block divided by two.
-#define BOX_HALF (BOX / 2)
-
-// the interval which is used to tick game logics.
-#define TIMESTEP 17
-// the maximum size of the state cache.
-#define STATE_CACHE_SIZE 10
-// the amount of milliseconds to wait before each ball launch.
-#define COUNTDOWN_MS 2000
-// the amount of milliseconds to wait before ending the game.
-#define END_COUNTDOWN_MS 2000
-// the target score limit.
-#define SCORE_LIMIT 10
-
-// the height for both paddles at the sides of the scene.
-#define PADDLE_HEIGHT (RESOLUTION_HEIGHT / 6)
-// the height for both paddles divided by two.
-#define PADDLE_HALF_HEIGHT (PADDLE_HEIGHT / 2)
-// the width for both paddles at the sides of the scene.
-#define PADDLE_WIDTH BOX
-// the amount of offset between paddle and the side of the scene.
-#define PADDLE_EDGE_OFFSET (RESOLUTION_HEIGHT / 20)
-// the movement velocity for the paddles.
-#define PADDLE_VELOCITY (RESOLUTION_WIDTH / 100)
-
-// the width of the ball.
-#define BALL_WIDTH BOX
-// the height of the ball.
-#define BALL_HEIGHT BOX
-// the initial velocity for the ball.
-#define BALL_INITIAL_VELOCITY (RESOLUTION_HEIGHT / 300)
-// the amount of velocity to increase on each ball-paddle hit.
-#define BALL_VELOCITY_INCREMENT 1
-
 // the width for the score indicator numbers.
 #define SCORE_WIDTH (RESOLUTION_WIDTH / 10)
 // the height for the score indicator numbers.
@@ -81,59 +38,36 @@
 // the y-coordinate of the up-left position of the left score number.
 #define SCORE_Y (RESOLUTION_HEIGHT / 10)
 
-// available network node modes.
-enum Mode { CLIENT, SERVER };
-// available application states.
-enum State { RUNNING, STOPPED };
-// available dynamic object movement directions.
-enum Direction { UP = -1, DOWN = 1, LEFT = -1, RIGHT = 1, NONE = 0 };
-// available network transport modes.
-enum Transport { TCP, UDP };
+// the maximum amount of rects rendered with a single call (objects, scores and statics).
+#define RENDER_MAX_RECTS (3 + 2 * 8 + 2 + 15)
+
+// the default maximum amount of simulation steps run within a single frame.
+#define DEFAULT_MAX_STEPS 5
+// the default target amount of rendered frames per second.
+#define DEFAULT_FPS 60
+// the start time (ms) of the virtual clock of a headless simulation (match times must be positive).
+#define SIM_CLOCK_START 1000
+// the default maximum interval (ms) between presented frames when nothing changes.
+#define DEFAULT_RENDER_HEARTBEAT 1000
+// the amount of frames the ball takes to cross the field in the render benchmark.
+#define BENCH_BALL_FRAMES 90
+// the amount of frames a paddle takes to cross the field in the render benchmark.
+#define BENCH_PADDLE_FRAMES 70
 
 // ============================================================================
 
-// a function pointer type for sending messages over the network.
-typedef void (*net_send_func)(const char*);
+// a function pointer type for flushing the batched messages to the network.
+typedef void (*net_flush_func)();
 // a function pointer type for receiving messages from the network.
 typedef void (*net_receive_func)();
 // a function pointer type for the network system initialization.
 typedef void (*net_start_func)();
+// a function pointer type for waiting for incoming data with a timeout (ms).
+// returns -1 on an error, zero on a timeout and above zero when data is available.
+typedef int (*net_wait_func)(int timeout);
 
 // ============================================================================
 
-typedef struct {
-  // the timestamp of the state.
-  int time;
-  // the rect of the state.
-  SDL_Rect rect;
-} State;
-
-typedef struct {
-  // the array of dynamic object states.
-  State states[STATE_CACHE_SIZE];
-  // an index to the most recent state.
-  int most_recent_state_index;
-  // a definition whether the current node owns the object.
-  int owned;
-  // the movement speed.
-  int velocity;
-  // the movement direction in x-axis.
-  int direction_x;
-  // the movement direction in y-axis.
-  int direction_y;
-} DynamicObject;
-
-// ============================================================================
-
-// boundaries of the non-moving wall at the top of the scene.
-const SDL_Rect TOP_WALL = { 0, 0, RESOLUTION_WIDTH, BOX };
-// boundaries of the non-moving wall at the bottom of the scene.
-const SDL_Rect BOTTOM_WALL = { 0, RESOLUTION_HEIGHT - BOX, RESOLUTION_WIDTH, BOX };
-// the boundaries of the invisible left goal.
-const SDL_Rect LEFT_GOAL = { -1000, 0, (1000 - BOX), RESOLUTION_HEIGHT };
-// the boundaries of the invisible right goal.
-const SDL_Rect RIGHT_GOAL = { RESOLUTION_WIDTH + BOX, 0, 1000, RESOLUTION_HEIGHT };
-
 // boundaries of the center line containing 15 boxes.
 const SDL_Rect CENTER_LINE[15] = {
   { RESOLUTION_HALF_WIDTH - BOX_HALF, BOX + (0 * 1.93f * BOX), BOX, BOX},
@@ -153,28 +87,6 @@ const SDL_Rect CENTER_LINE[15] = {
   { RESOLUTION_HALF_WIDTH - BOX_HALF, BOX + (14 * 1.93f * BOX), BOX, BOX}
 };
 
-// the starting position of the left paddle.
-const SDL_Rect LEFT_PADDLE_START = {
-  PADDLE_EDGE_OFFSET,
-  RESOLUTION_HALF_HEIGHT - PADDLE_HALF_HEIGHT,
-  PADDLE_WIDTH,
-  PADDLE_HEIGHT
-};
-// the starting position of the right paddle.
-const SDL_Rect RIGHT_PADDLE_START = {
-  RESOLUTION_WIDTH - PADDLE_EDGE_OFFSET - BOX,
-  RESOLUTION_HALF_HEIGHT - PADDLE_HALF_HEIGHT,
-  PADDLE_WIDTH,
-  PADDLE_HEIGHT
-};
-// the starting position for the game ball.
-const SDL_Rect BALL_START = {
-  RESOLUTION_HALF_WIDTH - BOX_HALF,
-  RESOLUTION_HALF_HEIGHT - BOX_HALF,
-  BALL_WIDTH,
-  BALL_HEIGHT
-};
-
 // horizontal line rectangles used with left score indicator.
 const SDL_Rect SCORE_LEFT_PARTS[8] = {
   { SCORE_LEFT_X, SCORE_Y, SCORE_WIDTH, SCORE_THICKNESS },
@@ -199,21 +111,29 @@ const SDL_Rect SCORE_RIGHT_PARTS[8] = {
   { SCORE_RIGHT_X + SCORE_HALF_WIDTH - SCORE_THICKNESS, SCORE_Y, SCORE_THICKNESS, SCORE_HEIGHT }
 };
 
+// the score indicator parts (bit per part index) used by each number from 0 to 9.
+const Uint8 SCORE_DIGIT_PARTS[10] = {
+  0x7d, 0x80, 0x37, 0x67, 0x6a, 0x4f, 0x5f, 0x61, 0x7f, 0x6f
+};
+
 // ============================================================================
 
-static void ping_send_response(int pingTime);
-static int get_ticks_without_offset();
-static int get_ticks();
-static int random_vertical_direction();
-static int random_horizontal_direction();
-static void reset_client(int time);
-static void reset_server(int time);
-static void tcp_send(const char* msg);
-static void udp_send(const char* msg);
+static void tcp_send(Match* match, const Message* msg);
+static void udp_send(Match* match, const Message* msg);
+static void tcp_flush();
+static void udp_flush();
 static void tcp_receive();
 static void udp_receive();
 static void tcp_start();
 static void udp_start();
+static void sim_start();
+static void sim_flush();
+static void sim_receive();
+static int sim_wait(int timeout);
+static Uint32 sim_clock();
+static int socket_wait(int timeout);
+static int udp_wait_acks(int timeout);
+static void render_background();
 
 // ============================================================================
 
@@ -221,85 +141,255 @@ static void udp_start();
 static int sMode = SERVER;
 // the network host (NULL for server).
 static char* sHost = NULL;
-// the network transport mode (TCP/UDP).
+// the network transport mode (TCP/UDP/NETSIM).
 static int sTransport = TCP;
+// a definition whether to run without video and rendering.
+static int sHeadless = 0;
+// a definition whether to host multiple matches (one per client).
+static int sMulti = 0;
+// the amount of worker threads for the multi-match server (zero for one per core).
+static int sWorkers = 0;
+// the maximum amount of simulation steps run within a single frame.
+static int sMaxSteps = DEFAULT_MAX_STEPS;
+// the target amount of rendered frames per second (zero for no limit).
+static int sTargetFps = DEFAULT_FPS;
+// a definition whether to synchronize the rendering with the display refresh.
+static int sVsync = 0;
+// the maximum interval (ms) between unchanged frames (zero to present every frame).
+static int sRenderHeartbeat = DEFAULT_RENDER_HEARTBEAT;
+// a definition whether to render into an offscreen surface without a window.
+static int sOffscreen = 0;
+// the directory where the presented offscreen frames are dumped (NULL for none).
+static const char* sDumpPath = NULL;
+// the directory of the golden frames compared with the presented ones (NULL for none).
+static const char* sGoldenPath = NULL;
+// the amount of frames rendered by the render benchmark (zero to play a match).
+static int sBenchFrames = 0;
+// a definition whether the local paddle is controlled by a bot.
+static int sBotEnabled = 0;
+// the reaction delay (ms) of the bots.
+static int sBotReaction = BOT_DEFAULT_REACTION;
+// the maximum aiming error (pixels) of the bots.
+static int sBotError = BOT_DEFAULT_ERROR;
+// the file where the metrics are periodically written (NULL for none).
+static const char* sMetricsFile = NULL;
+// the port of the HTTP endpoint serving the metrics (zero for none).
+static int sMetricsPort = 0;
+// the file where the trace events are written (NULL for none).
+static const char* sTraceFile = NULL;
+// the file where the events of the match are recorded (NULL for none).
+static const char* sRecordFile = NULL;
 
 // the main window of the application.
 static SDL_Window* sWindow = NULL;
 // the renderer for the main window.
 static SDL_Renderer* sRenderer = NULL;
+// the offscreen surface used as the render target without a window.
+static SDL_Surface* sSurface = NULL;
+// the cached background texture with the static objects (NULL when not supported).
+static SDL_Texture* sBackground = NULL;
+// the dynamic object rects of the most recently presented frame.
+static SDL_Rect sPresentedRects[RENDER_MAX_RECTS];
+// the amount of rects in the most recently presented frame.
+static int sPresentedCount = 0;
+// the time when the most recent frame was presented.
+static int sPresentedTicks = 0;
+// a definition whether the next frame must be presented even without changes.
+static int sRedraw = 1;
+// the amount of presented frames.
+static int sPresentedFrames = 0;
+// the amount of frames skipped without any visible changes.
+static int sSkippedFrames = 0;
+// the amount of presented frames that differed from their golden frames.
+static int sFrameMismatches = 0;
 
 // the socket used in the TCP communication.
 static TCPsocket sTCPsocket = NULL;
-// the message buffer for outgoing TCP stream data.
-static char sTCPSend[NETWORK_BUFFER_SIZE];
-// the message buffer for incoming TCP stream data.
-static char sTCPRecv[NETWORK_BUFFER_SIZE];
-
-// the TCP message stream buffer to handle network messages.
-static char sStreamBuffer[NETWORK_BUFFER_SIZE];
-// the TCP message stream cursor to follow stream content.
-static int sStreamCursor = 0;
+// the message batch buffer for outgoing TCP stream data.
+static Uint8 sTCPSend[NETWORK_BUFFER_SIZE];
+// the amount of batched bytes in the outgoing TCP buffer.
+static int sTCPSendSize = 0;
+// the ring buffer for incoming TCP stream data.
+static RingBuffer sTCPStream;
 
 // the socket used in the UDP communication.
 static UDPsocket sUDPsocket = NULL;
 // the port and host used as the UDP communication target.
 static IPaddress sUDPaddress;
-// the outgoing package structure used to send UDP data.
+// the outgoing package structure used to batch and send UDP data.
 static UDPpacket* sUDPSendPacket = NULL;
+// the preallocated packet vector used to receive UDP data.
+static UDPpacket** sUDPRecvPackets = NULL;
+// the reliable channel used to deliver the control messages over UDP.
+static Channel sUDPChannel;
+// the batch buffer for the unreliable outgoing UDP messages.
+static Uint8 sUDPBatch[NETWORK_MTU];
+// the amount of batched bytes in the unreliable UDP batch buffer.
+static int sUDPBatchSize = 0;
 
 // the socket set used to listen for socket activities.
 static SDLNet_SocketSet sSocketSet = NULL;
 
-// the state of the application.
-static int sState = RUNNING;
-// the time (with offset) of the previous tick.
-static int sPreviousTick = 0;
-// the offset used to synchronize clocks among nodes.
-static int sTickOffset = 0;
-// the definition when to send next ping request.
-static int sNextPingTicks = 0;
-// the remote lag used to compensate latency.
-static int sRemoteLag = 0;
-// the countdown time used to detect when ball should be launched.
-static int sCountdown = 0;
-// the countdown time when the game ends and exits.
-static int sEndCountdown = INT_MAX;
-
-// the server's paddle shown at the left side of the scene.
-static DynamicObject sLeftPaddle;
-// the client's paddle shown at the right side of the scene.
-static DynamicObject sRightPaddle;
-// the ball moving across the scene.
-static DynamicObject sBall;
-
-// the points of the left player.
-static int sLeftPoints = 0;
-// the points of the right player.
-static int sRightPoints = 0;
-
-// a function pointer to a function to send data to remote node.
-static net_send_func net_send = &tcp_send;
+// the simulated links from the local to the remote node and back.
+static NetSimLink sSimLinks[2];
+// the simulated network endpoint of the local match.
+static NetSimNode sSimNode;
+// the simulated network endpoint of the in-process remote match.
+static NetSimNode sSimPeerNode;
+// the in-process remote match played over the simulated network.
+static Match sSimPeer;
+// the accumulated time (ms) not yet simulated by the in-process remote match.
+static int sSimPeerAccumulator = 0;
+// the time when the in-process remote match was last advanced.
+static int sSimPeerTicks = 0;
+// the bot controlling the paddle of the in-process remote match.
+static Bot sSimPeerBot;
+// the virtual time (ms) of a headless simulated match.
+static Uint32 sSimClock = SIM_CLOCK_START;
+
+// the match played by the application.
+static Match sMatch;
+// the bot controlling the local paddle when enabled.
+static Bot sBot;
+// the recorder of the match events when recording is enabled.
+static Recorder sRecorder;
+
+// a function pointer to a function to flush batched data to a remote node.
+static net_flush_func net_flush = &tcp_flush;
 // a function pointer to a function to receive data from a remote node.
 static net_receive_func net_receive = &tcp_receive;
 // a function pointer to a function to initialize the network system.
 static net_start_func net_start = &tcp_start;
+// a function pointer to a function to wait for data from a remote node.
+static net_wait_func net_wait = &socket_wait;
 
 // ============================================================================
 
 static void parse_arguments(int argc, char* argv[])
 {
-  // parse definitions from the provided command line arguments.
+  // separate the optional flags from the positional arguments.
   printf("Parsing [%d] argument(s)...\n", (argc - 1));
-  sMode = (argc > 2 ? CLIENT : SERVER);
-  sTransport = (argc <= 1 ? TCP : strncmp("tcp", argv[1], 3) == 0 ? TCP : UDP);
-  sHost = (argc <= 2 ? NULL : argv[2]);
+  char* positional[2] = { NULL, NULL };
+  int positionals = 0;
+  NetSimConfig simConfig = *netsim_get_config();
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--text") == 0) {
+      protocol_set_format(TEXT);
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      sHeadless = 1;
+    } else if (strcmp(argv[i], "--multi") == 0) {
+      sMulti = 1;
+      sHeadless = 1;
+    } else if (strcmp(argv[i], "--rollback") == 0) {
+      match_set_netcode(NETCODE_ROLLBACK);
+    } else if (strcmp(argv[i], "--predict") == 0) {
+      match_set_netcode(NETCODE_PREDICT);
+    } else if (strncmp(argv[i], "--workers=", 10) == 0) {
+      sWorkers = atoi(argv[i] + 10);
+    } else if (strncmp(argv[i], "--fps=", 6) == 0) {
+      sTargetFps = SDL_max(0, atoi(argv[i] + 6));
+    } else if (strcmp(argv[i], "--vsync") == 0) {
+      sVsync = 1;
+    } else if (strncmp(argv[i], "--heartbeat=", 12) == 0) {
+      sRenderHeartbeat = SDL_max(0, atoi(argv[i] + 12));
+    } else if (strcmp(argv[i], "--offscreen") == 0) {
+      sOffscreen = 1;
+    } else if (strncmp(argv[i], "--dump=", 7) == 0) {
+      sDumpPath = argv[i] + 7;
+      sOffscreen = 1;
+    } else if (strncmp(argv[i], "--golden=", 9) == 0) {
+      sGoldenPath = argv[i] + 9;
+      sOffscreen = 1;
+    } else if (strncmp(argv[i], "--render-bench=", 15) == 0) {
+      sBenchFrames = SDL_max(1, atoi(argv[i] + 15));
+    } else if (strncmp(argv[i], "--max-steps=", 12) == 0) {
+      sMaxSteps = SDL_max(1, atoi(argv[i] + 12));
+    } else if (strncmp(argv[i], "--keyframe=", 11) == 0) {
+      snapshot_set_keyframe_interval(SDL_max(0, atoi(argv[i] + 11)));
+    } else if (strncmp(argv[i], "--metrics-file=", 15) == 0) {
+      sMetricsFile = argv[i] + 15;
+    } else if (strncmp(argv[i], "--metrics-port=", 15) == 0) {
+      sMetricsPort = SDL_max(0, SDL_min(65535, atoi(argv[i] + 15)));
+    } else if (strncmp(argv[i], "--record=", 9) == 0) {
+      sRecordFile = argv[i] + 9;
+    } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+      sTraceFile = argv[i] + 8;
+    } else if (strcmp(argv[i], "--bot") == 0) {
+      sBotEnabled = 1;
+    } else if (strncmp(argv[i], "--bot-reaction=", 15) == 0) {
+      sBotReaction = SDL_max(0, atoi(argv[i] + 15));
+    } else if (strncmp(argv[i], "--bot-error=", 12) == 0) {
+      sBotError = SDL_max(0, atoi(argv[i] + 12));
+    } else if (strncmp(argv[i], "--sim-delay=", 12) == 0) {
+      simConfig.delay = SDL_max(0, atoi(argv[i] + 12));
+    } else if (strncmp(argv[i], "--sim-jitter=", 13) == 0) {
+      simConfig.jitter = SDL_max(0, atoi(argv[i] + 13));
+    } else if (strncmp(argv[i], "--sim-loss=", 11) == 0) {
+      simConfig.loss = SDL_max(0, SDL_min(100, atoi(argv[i] + 11)));
+    } else if (strncmp(argv[i], "--sim-duplicate=", 16) == 0) {
+      simConfig.duplicate = SDL_max(0, SDL_min(100, atoi(argv[i] + 16)));
+    } else if (strncmp(argv[i], "--sim-reorder=", 14) == 0) {
+      simConfig.reorder = SDL_max(0, SDL_min(100, atoi(argv[i] + 14)));
+    } else if (strncmp(argv[i], "--sim-seed=", 11) == 0) {
+      simConfig.seed = (Uint32)strtoul(argv[i] + 11, NULL, 10);
+    } else if (positionals < 2) {
+      positional[positionals++] = argv[i];
+    }
+  }
+
+  // parse definitions from the provided positional arguments.
+  sMode = (positionals > 1 ? CLIENT : SERVER);
+  sTransport = (positionals < 1 ? TCP
+    : strncmp("tcp", positional[0], 3) == 0 ? TCP
+    : strncmp("sim", positional[0], 3) == 0 ? NETSIM : UDP);
+  netsim_set_config(&simConfig);
+  sHost = (positionals < 2 ? NULL : positional[1]);
 
   // inform about the successfully parse values.
   printf("Parsed following arguments from the command line:\n");
   printf("\tmode: %s\n", (sMode == CLIENT ? "client" : "server"));
   printf("\thost: %s\n", (sHost == NULL ? "" : sHost));
-  printf("\ttype: %s\n", (sTransport == TCP ? "TCP" : "UDP"));
+  printf("\ttype: %s\n", (sTransport == TCP ? "TCP" : sTransport == UDP ? "UDP" : "simulated"));
+  printf("\tformat: %s\n", (protocol_get_format() == TEXT ? "text" : "binary"));
+  printf("\theadless: %s\n", (sHeadless == 1 ? "yes" : "no"));
+  printf("\tmulti: %s\n", (sMulti == 1 ? "yes" : "no"));
+  printf("\tworkers: %d\n", sWorkers);
+  printf("\tmax-steps: %d\n", sMaxSteps);
+  printf("\tfps: %d%s\n", sTargetFps, (sVsync == 1 ? " (vsync)" : ""));
+  printf("\theartbeat: %d\n", sRenderHeartbeat);
+  printf("\toffscreen: %s\n", (sOffscreen == 1 ? "yes" : "no"));
+  printf("\tnetcode: %s\n", (match_get_netcode() == NETCODE_ROLLBACK ? "rollback"
+    : match_get_netcode() == NETCODE_PREDICT ? "predict" : "lag"));
+  printf("\tkeyframe: %d\n", snapshot_get_keyframe_interval());
+  printf("\tmetrics: file %s, port %d\n", (sMetricsFile == NULL ? "none" : sMetricsFile),
+    sMetricsPort);
+  printf("\ttrace: %s\n", (sTraceFile == NULL ? "none" : sTraceFile));
+  printf("\trecord: %s\n", (sRecordFile == NULL ? "none" : sRecordFile));
+  printf("\tbot: %s (reaction %d, error %d)\n", (sBotEnabled == 1 ? "yes" : "no"),
+    sBotReaction, sBotError);
+  if (sTransport == NETSIM) {
+    printf("\tsimulation: delay %d, jitter %d, loss %d%%, duplicate %d%%, reorder %d%%, seed %u\n",
+      simConfig.delay, simConfig.jitter, simConfig.loss, simConfig.duplicate,
+      simConfig.reorder, (unsigned)simConfig.seed);
+  }
+
+  // a headless node has no display or input, so it can only act as a server.
+  if (sHeadless == 1 && sMode != SERVER) {
+    printf("Headless mode is only supported for servers!\n");
+    exit(EXIT_FAILURE);
+  }
+  if (sMulti == 1 && sTransport == NETSIM) {
+    printf("Multi-match servers do not support the simulated network!\n");
+    exit(EXIT_FAILURE);
+  }
+  if (sMulti == 1 && sRecordFile != NULL) {
+    printf("Multi-match servers do not support recording!\n");
+    exit(EXIT_FAILURE);
+  }
+  if (sHeadless == 1 && (sOffscreen == 1 || sBenchFrames > 0)) {
+    printf("Headless mode does not render any frames!\n");
+    exit(EXIT_FAILURE);
+  }
 }
 
 // ============================================================================
@@ -316,6 +406,27 @@ static void destroy_renderer()
   SDL_DestroyRenderer(sRenderer);
 }
 
+// ============================================================================
+// destroy and release the offscreen render surface.
+static void destroy_surface()
+{
+  SDL_FreeSurface(sSurface);
+}
+
+// ============================================================================
+// write the remaining recorded events and close the recording.
+static void close_recorder()
+{
+  record_close(&sRecorder);
+}
+
+// ============================================================================
+// destroy and release the cached background texture.
+static void destroy_background()
+{
+  SDL_DestroyTexture(sBackground);
+}
+
 // ============================================================================
 // close and destroy the application TCP socket.
 static void close_tcp_socket()
@@ -338,34 +449,17 @@ static void close_udp_send_packet()
 }
 
 // ============================================================================
-// close and destroy the application's socket set.
-static void close_socket_set()
+// close and destroy the application UDP receive packets.
+static void close_udp_recv_packets()
 {
-  SDLNet_FreeSocketSet(sSocketSet);
+  SDLNet_FreePacketV(sUDPRecvPackets);
 }
 
 // ============================================================================
-// give a point to the target player.
-static void give_point(int player)
+// close and destroy the application's socket set.
+static void close_socket_set()
 {
-  SDL_assert(player >= 0);
-  SDL_assert(player <= 1);
-
-  // increment points of the target player.
-  printf("A point for %s player!\n", (player == 0 ? "left" : "right"));
-  int endGame = 0;
-  if (player == 0) {
-    sLeftPoints++;
-    endGame = (sLeftPoints >= SCORE_LIMIT ? 1 : 0);
-  } else {
-    sRightPoints++;
-    endGame = (sRightPoints >= SCORE_LIMIT ? 1 : 0);
-  }
-
-  // check whether we should end the game.
-  if (endGame == 1) {
-    net_send("end");
-  }
+  SDLNet_FreeSocketSet(sSocketSet);
 }
 
 // ============================================================================
@@ -374,8 +468,8 @@ static void initialize(int argc, char* argv[])
 {
   parse_arguments(argc, argv);
 
-  // initialize the core SDL framework.
-  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+  // initialize the core SDL framework (only events without a display).
+  if (SDL_Init(sHeadless == 1 || sOffscreen == 1 ? SDL_INIT_EVENTS : SDL_INIT_VIDEO) != 0) {
     printf("SDL_Init: %s\n", SDL_GetError());
     exit(EXIT_FAILURE);
   }
@@ -388,161 +482,133 @@ static void initialize(int argc, char* argv[])
   }
   atexit(SDLNet_Quit);
 
-  // create the main window for the application.
-  sWindow = SDL_CreateWindow(
-    "Pong",
-    SDL_WINDOWPOS_CENTERED,
-    SDL_WINDOWPOS_CENTERED,
-    RESOLUTION_WIDTH,
-    RESOLUTION_HEIGHT,
-    SDL_WINDOW_SHOWN);
-  if (sWindow == NULL) {
-    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+  // publish the metrics with a stats file and a HTTP endpoint when requested.
+  if (metrics_serve(sMetricsPort) != 0) {
     exit(EXIT_FAILURE);
   }
-  atexit(destroy_window);
-
-  // create the main renderer for the application window.
-  sRenderer = SDL_CreateRenderer(
-    sWindow,
-    -1,
-    SDL_RENDERER_ACCELERATED);
-  if (sRenderer == NULL) {
-    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
-    exit(EXIT_FAILURE);
+  atexit(metrics_close);
+  metrics_set_file(sMetricsFile);
+  atexit(metrics_flush);
+
+  // record the trace events to be written on demand and when the application exits.
+  trace_set_file(sTraceFile);
+  atexit(trace_flush);
+
+  // create a software renderer for an offscreen surface when there is no display.
+  if (sHeadless == 0 && sOffscreen == 1) {
+    sSurface = SDL_CreateRGBSurfaceWithFormat(
+      0,
+      RESOLUTION_WIDTH,
+      RESOLUTION_HEIGHT,
+      32,
+      SDL_PIXELFORMAT_RGB888);
+    if (sSurface == NULL) {
+      printf("SDL_CreateRGBSurfaceWithFormat: %s\n", SDL_GetError());
+      exit(EXIT_FAILURE);
+    }
+    atexit(destroy_surface);
+
+    sRenderer = SDL_CreateSoftwareRenderer(sSurface);
+    if (sRenderer == NULL) {
+      printf("SDL_CreateSoftwareRenderer: %s\n", SDL_GetError());
+      exit(EXIT_FAILURE);
+    }
+    atexit(destroy_renderer);
   }
-  atexit(destroy_renderer);
-
-  // seed the random generator.
-  srand(time(NULL));
-
-  // initialize the paddle show at the left side of the scene.
-  sLeftPaddle.owned = (sMode == SERVER ? 1 : 0);
-  sLeftPaddle.most_recent_state_index = 0;
-  sLeftPaddle.direction_x = NONE;
-  sLeftPaddle.direction_y = NONE;
-  sLeftPaddle.velocity = PADDLE_VELOCITY;
-  for (int i = 0; i < STATE_CACHE_SIZE; i++) {
-    sLeftPaddle.states[i].time = 0;
-    sLeftPaddle.states[i].rect = LEFT_PADDLE_START;
+
+  // create the main window and renderer unless running without video.
+  if (sHeadless == 0 && sOffscreen == 0) {
+    sWindow = SDL_CreateWindow(
+      "Pong",
+      SDL_WINDOWPOS_CENTERED,
+      SDL_WINDOWPOS_CENTERED,
+      RESOLUTION_WIDTH,
+      RESOLUTION_HEIGHT,
+      SDL_WINDOW_SHOWN);
+    if (sWindow == NULL) {
+      printf("SDL_CreateWindow: %s\n", SDL_GetError());
+      exit(EXIT_FAILURE);
+    }
+    atexit(destroy_window);
+
+    // create the main renderer for the application window.
+    sRenderer = SDL_CreateRenderer(
+      sWindow,
+      -1,
+      SDL_RENDERER_ACCELERATED | (sVsync == 1 ? SDL_RENDERER_PRESENTVSYNC : 0));
+    if (sRenderer == NULL) {
+      printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+      exit(EXIT_FAILURE);
+    }
+    atexit(destroy_renderer);
   }
 
-  // initialize the paddle show at the right side of the scene.
-  sRightPaddle.owned = (sMode == CLIENT ? 1 : 0);
-  sRightPaddle.most_recent_state_index = 0;
-  sRightPaddle.direction_x = NONE;
-  sRightPaddle.direction_y = NONE;
-  sRightPaddle.velocity = PADDLE_VELOCITY;
-  for (int i = 0; i < STATE_CACHE_SIZE; i++) {
-    sRightPaddle.states[i].time = 0;
-    sRightPaddle.states[i].rect = RIGHT_PADDLE_START;
+  // cache the static objects into a texture when the renderer supports it.
+  if (sRenderer != NULL) {
+    sBackground = SDL_CreateTexture(
+      sRenderer,
+      SDL_PIXELFORMAT_RGB888,
+      SDL_TEXTUREACCESS_TARGET,
+      RESOLUTION_WIDTH,
+      RESOLUTION_HEIGHT);
+    if (sBackground != NULL) {
+      atexit(destroy_background);
+      render_background();
+    } else {
+      printf("SDL_CreateTexture: %s (drawing the background on each frame)\n", SDL_GetError());
+    }
   }
 
-  // initialize the ball to start from the middle of the scene.
-  sBall.owned = 1;
-  sBall.most_recent_state_index = 0;
-  sBall.direction_x = NONE;
-  sBall.direction_y = NONE;
-  sBall.velocity = BALL_INITIAL_VELOCITY;
-  for (int i = 0; i < STATE_CACHE_SIZE; i++) {
-    sBall.states[i].time = 0;
-    sBall.states[i].rect = BALL_START;
+  // a headless simulated match runs on a virtual clock instead of sleeping to be exactly reproducible.
+  if (sTransport == NETSIM && sHeadless == 1) {
+    match_set_time_source(&sim_clock);
+  }
+
+  // seed the random generator (stored in the recording to replay the same numbers).
+  // a simulated match uses the seed of the simulation to reproduce the whole match.
+  Uint32 seed = (sTransport == NETSIM ? netsim_get_config()->seed : (Uint32)time(NULL));
+  srand(seed);
+  bot_init(&sBot, sBotReaction, sBotError, seed);
+  if (sRecordFile != NULL) {
+    RecordHeader header = {
+      sMode, match_get_netcode(), snapshot_get_keyframe_interval(), seed, (int)match_get_time_source()()
+    };
+    if (record_open(&sRecorder, sRecordFile, &header) != 0) {
+      exit(EXIT_FAILURE);
+    }
+    sRecorder.lossless = (match_get_time_source() == &sim_clock ? 1 : 0);
+    atexit(close_recorder);
   }
 
   // initialize function pointers and buffers to transport type functions.
   switch (sTransport) {
     case TCP:
-      net_send = &tcp_send;
+      match_init(&sMatch, sMode, &tcp_send, NULL);
+      net_flush = &tcp_flush;
       net_receive = &tcp_receive;
       net_start = &tcp_start;
       break;
     case UDP:
-      net_send = &udp_send;
+      match_init(&sMatch, sMode, &udp_send, NULL);
+      net_flush = &udp_flush;
       net_receive = &udp_receive;
       net_start = &udp_start;
       break;
+    case NETSIM:
+      // the remote node plays within this process over the simulated links.
+      match_init(&sMatch, sMode, &netsim_send, &sSimNode);
+      match_init(&sSimPeer, (sMode == SERVER ? CLIENT : SERVER), &netsim_send, &sSimPeerNode);
+      net_flush = &sim_flush;
+      net_receive = &sim_receive;
+      net_start = &sim_start;
+      net_wait = &sim_wait;
+      break;
     default:
       printf("Unsupported transport %d!\n", sTransport);
       exit(EXIT_FAILURE);
       break;
   }
-}
-
-// ============================================================================
-// Get a rect for the given time for the target object.
-static SDL_Rect state_get(DynamicObject* object, int time)
-{
-  SDL_assert(object != NULL);
-
-  // state checks are only required for non-owned objects.
-  if (object->owned != 1) {
-    // apply remote lag to keep non-owned objects in the past to compensate lag.
-    time = time - sRemoteLag;
-
-    int index = (object->most_recent_state_index + 1) % STATE_CACHE_SIZE;
-    if (object->states[index].time > time) {
-      return object->states[index].rect;
-    } else {
-      index = object->most_recent_state_index;
-      if (object->states[index].time <= time) {
-        return object->states[index].rect;
-      } else {
-        for (int i = 0; i < STATE_CACHE_SIZE; i++) {
-          index = abs(object->most_recent_state_index - i) % STATE_CACHE_SIZE;
-          if (object->states[index].time == time) {
-            return object->states[index].rect;
-          } else if (object->states[index].time > time) {
-            // calculate previous index and a time scalar.
-            int prevIndex = (index + 1) % STATE_CACHE_SIZE;
-            float t = (object->states[index].time - time) /
-                      (object->states[prevIndex].time - time);
-            SDL_Rect* prevRect = &object->states[prevIndex].rect;
-
-            // calculate a new rect by using a linear interpolation.
-            SDL_Rect rect = object->states[index].rect;
-            rect.x += (int)(t * (float)(prevRect->x - rect.x));
-            rect.y += (int)(t * (float)(prevRect->y - rect.y));
-            return rect;
-          }
-        }
-      }
-    }
-  }
-  return object->states[object->most_recent_state_index].rect;
-}
-
-// ============================================================================
-// set the given rect as a state for the given object at the given time.
-static void state_set(DynamicObject* object, const SDL_Rect* rect, int time)
-{
-  SDL_assert(object != NULL);
-  SDL_assert(rect != NULL);
-
-  // increment the most recent state index by one.
-  int index = object->most_recent_state_index;
-  index = (index + 1) % STATE_CACHE_SIZE;
-  object->most_recent_state_index = index;
-
-  // add the given state as the most recent state.
-  object->states[object->most_recent_state_index].time = time;
-  object->states[object->most_recent_state_index].rect = *rect;
-}
-
-// ============================================================================
-// set all states to given rect after the given from time point.
-static void state_clear(DynamicObject* object, const SDL_Rect* rect, int from)
-{
-  SDL_assert(object != NULL);
-  SDL_assert(rect != NULL);
-  SDL_assert(from > 0);
-
-  // clear all states starting from the given time.
-  for (int i = 0; i < STATE_CACHE_SIZE; i++) {
-    if (object->states[i].time >= from) {
-      object->states[i].time = from;
-      object->states[i].rect = *rect;
-    }
-  }
+  sMatch.recorder = (sRecordFile != NULL ? &sRecorder : NULL);
 }
 
 // ============================================================================
@@ -576,13 +642,24 @@ static void udp_start()
   }
 
   // allocate memory for the UDP packet to be used with outgoing data.
+  channel_init(&sUDPChannel);
+  sUDPBatchSize = 0;
   sUDPSendPacket = SDLNet_AllocPacket(NETWORK_BUFFER_SIZE);
   if (sUDPSendPacket == NULL) {
     printf("SDLNet_AllocPacket: %s\n", SDLNet_GetError());
     exit(EXIT_FAILURE);
   }
+  sUDPSendPacket->len = 0;
   atexit(close_udp_send_packet);
 
+  // allocate the packet vector to be used with incoming data.
+  sUDPRecvPackets = SDLNet_AllocPacketV(NETWORK_PACKET_POOL_SIZE, NETWORK_BUFFER_SIZE);
+  if (sUDPRecvPackets == NULL) {
+    printf("SDLNet_AllocPacketV: %s\n", SDLNet_GetError());
+    exit(EXIT_FAILURE);
+  }
+  atexit(close_udp_recv_packets);
+
   // make the server to wait until a client joins the game.
   if (sMode == SERVER) {
     printf("Waiting for a client to join the game...\n");
@@ -600,184 +677,133 @@ static void udp_start()
       exit(EXIT_FAILURE);
     }
 
-    // send the initial joining message to the server.
+    // send the initial joining message and wait until the server acknowledges it.
     printf("Sending a hello message to server...\n");
-    net_send("hello");
-    // TODO: wait and ensure that we get a response from the server.
+    Message msg = { .type = MESSAGE_HELLO };
+    udp_send(&sMatch, &msg);
+    if (udp_wait_acks(NETWORK_CONNECT_TIMEOUT) == 0) {
+      printf("Server did not respond to the hello message: Closing application...\n");
+      exit(EXIT_FAILURE);
+    }
+    printf("Server acknowledged the hello message.\n");
   }
 }
 
 // ============================================================================
-// send the given message to the remote node by using the UDP socket.
-static void udp_send(const char* msg)
+// send all batched messages to the remote node as a single UDP packet.
+static void udp_flush()
 {
-  SDL_assert(msg != NULL);
   SDL_assert(sTransport == UDP);
+  int now = SDL_GetTicks();
+  if (sUDPBatchSize == 0 && channel_has_output(&sUDPChannel, now) == 0) {
+    return;
+  }
 
-  // copy the target message into the packet.
-  int size = SDL_strlen(msg);
-  SDL_assert(size <= NETWORK_BUFFER_SIZE);
-  memcpy(sUDPSendPacket->data, msg, size);
-  sUDPSendPacket->len = size;
-  sUDPSendPacket->address = sUDPaddress;
+  // prefix the unreliable batch with the channel header and the reliable messages.
+  int length = channel_write(&sUDPChannel, sUDPSendPacket->data, NETWORK_MTU - sUDPBatchSize, now);
+  SDL_memcpy(sUDPSendPacket->data + length, sUDPBatch, sUDPBatchSize);
+  sUDPSendPacket->len = length + sUDPBatchSize;
 
   // send the given packet to remote nodes.
+  sUDPSendPacket->address = sUDPaddress;
   int sent = SDLNet_UDP_Send(sUDPsocket, -1, sUDPSendPacket);
   if (sent == 0) {
     printf("SDLNet_UDP_Send: %s\n", SDLNet_GetError());
     exit(EXIT_FAILURE);
   }
+  sUDPBatchSize = 0;
 }
 
 // ============================================================================
-// receive data from the remote node by using the UDP socket.
-static void udp_receive()
+// batch the given message to be sent to the remote node with the UDP socket.
+static void udp_send(Match* match, const Message* msg)
 {
+  SDL_assert(msg != NULL);
   SDL_assert(sTransport == UDP);
 
-  // allocate memory for a new UDP packet.
-  UDPpacket* packet = SDLNet_AllocPacket(NETWORK_BUFFER_SIZE);
-  if (packet == NULL) {
-    printf("SDLNet_AllocPacket: %s\n", SDLNet_GetError());
-    exit(EXIT_FAILURE);
+  // control messages are queued into the reliable channel.
+  if (channel_is_reliable(msg->type) == 1) {
+    if (channel_queue(&sUDPChannel, msg) < 0) {
+      printf("Remote node does not acknowledge messages: Closing application...\n");
+      match->state = STOPPED;
+    }
+    return;
   }
 
-  int packets = SDLNet_UDP_Recv(sUDPsocket, packet);
-  if (packets == -1) {
-    printf("SDLNet_UDP_Rect: %s\n", SDLNet_GetError());
-    exit(EXIT_FAILURE);
-  } else if (packets == 1) {
-    // ensure that we use the source address for outgoing messages.
-    sUDPaddress = packet->address;
-
-    // copy the UDP package contents into incoming buffer.
-    char buffer[NETWORK_BUFFER_SIZE];
-    memcpy(buffer, packet->data, packet->len);
-    buffer[packet->len] = '\0';
-
-    // process the message by using a tokenization.
-    char* token = strtok(buffer, ":");
-    if (strncmp(token, "quit", 4) == 0) {
-      printf("Remote node has closed the connection: Closing application...\n");
-      sState = STOPPED;
-    } else if (strncmp(token, "ping", 4) == 0) {
-      // get the ping time from the request.
-      token = strtok(NULL, ":");
-      int t0 = atoi(token);
-
-      // send a pong response back to requester.
-      ping_send_response(t0);
-    } else if (strncmp(token, "pong", 4) == 0) {
-      // get ping and pong times.
-      token = strtok(NULL, ":");
-      int t0 = atoi(token);
-      token = strtok(NULL, ":");
-      int t1 = atoi(token);
-
-      // calculate latency and delta to adjust clock offset and remote lag.
-      int t2 = get_ticks();
-      int rtt = (t2 - t0);
-      int lag = (rtt / 2);
-      sRemoteLag = lag + (50 - (lag % 50));
-      if (sMode == SERVER) {
-        printf("rtt:%d remoteLag:%d\n", rtt, sRemoteLag);
-      } else {
-        int cc = ((t1 - t0) + (t1 - t2)) / 2;
-        sTickOffset += cc;
-        printf("rtt:%d remoteLag:%d cc:%d co:%d\n", rtt, sRemoteLag, cc, sTickOffset);
-      }
-    } else if (strncmp(token, "left", 4) == 0) {
-        // get time, x and y positions.
-        token = strtok(NULL, ":");
-        int t = atoi(token);
-        token = strtok(NULL, ":");
-        int x = atoi(token);
-        token = strtok(NULL, ":");
-        int y = atoi(token);
-
-        // create a new state and assign it to states array.
-        SDL_Rect rect = {x, y, PADDLE_WIDTH, PADDLE_HEIGHT };
-        state_set(&sLeftPaddle, &rect, t);
-    } else if (strncmp(token, "right", 5) == 0) {
-      // get time, x and y positions.
-      token = strtok(NULL, ":");
-      int t = atoi(token);
-      token = strtok(NULL, ":");
-      int x = atoi(token);
-      token = strtok(NULL, ":");
-      int y = atoi(token);
-
-      // create a new state and assign it to states array.
-      SDL_Rect rect = {x, y, PADDLE_WIDTH, PADDLE_HEIGHT };
-      state_set(&sRightPaddle, &rect, t);
-    } else if (strncmp(token, "ball", 4) == 0) {
-      // get time, x and y positions.
-      token = strtok(NULL, ":");
-      int t = atoi(token);
-      token = strtok(NULL, ":");
-      int x = atoi(token);
-      token = strtok(NULL, ":");
-      int y = atoi(token);
-      token = strtok(NULL, ":");
-      int dirX = atoi(token);
-      token = strtok(NULL, ":");
-      int dirY = atoi(token);
-      token = strtok(NULL, ":");
-      int velocity = atoi(token);
-
-      // check if we need to correct the position and direction of the ball.
-      SDL_Rect rect = {x, y, BALL_WIDTH, BALL_HEIGHT };
-      SDL_Rect usedRect = state_get(&sBall, t);
-      if (usedRect.x != rect.x || usedRect.y != rect.y
-        || dirX != sBall.direction_x || dirY != sBall.direction_y
-        || velocity != sBall.velocity) {
-        state_clear(&sBall, &rect, t);
-        state_set(&sBall, &rect, t);
-        sBall.direction_x = dirX;
-        sBall.direction_y = dirY;
-        sBall.velocity = velocity;
-      }
-    } else if (strncmp(token, "reset", 5) == 0) {
-      SDL_assert(sMode == CLIENT);
-
-      // get time, countdown, ball directions and points.
-      token = strtok(NULL, ":");
-      int t = atoi(token);
-      token = strtok(NULL, ":");
-      sCountdown = atoi(token);
-      token = strtok(NULL, ":");
-      int x = atoi(token);
-      token = strtok(NULL, ":");
-      int y = atoi(token);
-      token = strtok(NULL, ":");
-      sLeftPoints = atoi(token);
-      token = strtok(NULL, ":");
-      sRightPoints = atoi(token);
-
-      // assign ball directions.
-      sBall.direction_x = x;
-      sBall.direction_y = y;
-
-      // perform a client reset.
-      reset_client(t);
-    } else if (strncmp(token, "goal", 4) == 0) {
-      SDL_assert(sMode == SERVER);
-      give_point(0);
-      reset_server(get_ticks());
-    } else if (strncmp(token, "end-ok", 6) == 0) {
-      SDL_assert(sMode == SERVER);
-      sEndCountdown = get_ticks_without_offset() + END_COUNTDOWN_MS;
-    } else if (strncmp(token, "end", 3) == 0) {
-      SDL_assert(sMode == CLIENT);
-      sEndCountdown = get_ticks_without_offset() + END_COUNTDOWN_MS;
-      net_send("end-ok");
+  // encode the message into the batch and split the batch at the MTU.
+  int limit = NETWORK_MTU - CHANNEL_RESERVED_SIZE;
+  int size = protocol_encode(msg, sUDPBatch + sUDPBatchSize, limit - sUDPBatchSize);
+  if (size == 0) {
+    udp_flush();
+    size = protocol_encode(msg, sUDPBatch, limit);
+  }
+  SDL_assert(size > 0);
+  metrics_count_sent(msg->type, size);
+  sUDPBatchSize += size;
+}
+
+// ============================================================================
+// send and receive until the reliable messages are acknowledged or the time runs out.
+// returns zero when some of the messages were not acknowledged.
+static int udp_wait_acks(int timeout)
+{
+  int deadline = SDL_GetTicks() + timeout;
+  while (channel_pending(&sUDPChannel) > 0 && (int)SDL_GetTicks() < deadline) {
+    udp_flush();
+    if (SDLNet_CheckSockets(sSocketSet, TIMESTEP) > 0) {
+      udp_receive();
     }
-  } else {
-    printf("There was %d packets in the UDP queue!\n", packets);
   }
+  return channel_pending(&sUDPChannel) == 0;
+}
+
+// ============================================================================
+// receive all queued data from the remote node by using the UDP socket.
+static void udp_receive()
+{
+  SDL_assert(sTransport == UDP);
+  SDL_assert(sUDPRecvPackets != NULL);
+
+  // drain the socket with the packet vector until no more packets are queued.
+  int packets = 0;
+  do {
+    packets = SDLNet_UDP_RecvV(sUDPsocket, sUDPRecvPackets);
+    if (packets == -1) {
+      printf("SDLNet_UDP_RecvV: %s\n", SDLNet_GetError());
+      exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < packets; i++) {
+      UDPpacket* packet = sUDPRecvPackets[i];
+
+      // ensure that we use the source address for outgoing messages.
+      sUDPaddress = packet->address;
+
+      // skip duplicated, too old and malformed packets.
+      int offset = channel_read(&sUDPChannel, packet->data, packet->len, SDL_GetTicks());
+      if (offset < 0) {
+        continue;
+      }
 
-  // release memory reserved for the packet.
-  SDLNet_FreePacket(packet);
+      // dispatch the reliable messages in order before the unreliable ones.
+      Message msg;
+      while (channel_next(&sUDPChannel, &msg) == 1) {
+        match_dispatch(&sMatch, &msg);
+      }
+
+      // decode and dispatch all messages directly from the UDP package contents.
+      while (offset < packet->len) {
+        int length = protocol_decode(packet->data + offset, packet->len - offset, &msg);
+        if (length <= 0) {
+          printf("Received a malformed UDP packet: Ignoring it...\n");
+          break;
+        }
+        offset += length;
+        metrics_count_received(msg.type, length);
+        match_dispatch(&sMatch, &msg);
+      }
+    }
+  } while (packets == NETWORK_PACKET_POOL_SIZE && sMatch.state == RUNNING);
 }
 
 // ============================================================================
@@ -851,489 +877,346 @@ static void tcp_start()
 }
 
 // ============================================================================
-// send the given message to the remote node by using the TCP socket.
-static void tcp_send(const char* msg)
+// send all batched messages to the remote node with a single TCP send.
+static void tcp_flush()
 {
-  SDL_snprintf(sTCPSend, NETWORK_BUFFER_SIZE, "%s|", msg);
-  int size = SDL_strlen(sTCPSend);
-  SDL_assert(size <= NETWORK_BUFFER_SIZE);
-  if (SDLNet_TCP_Send(sTCPsocket, sTCPSend, size) != size) {
+  if (sTCPSendSize == 0) {
+    return;
+  }
+  if (SDLNet_TCP_Send(sTCPsocket, sTCPSend, sTCPSendSize) != sTCPSendSize) {
     printf("SDLNet_TCP_Send: %s\n", SDLNet_GetError());
     exit(EXIT_FAILURE);
   }
+  sTCPSendSize = 0;
+}
+
+// ============================================================================
+// batch the given message to be sent to the remote node with the TCP socket.
+static void tcp_send(Match* match, const Message* msg)
+{
+  (void)match;
+  int size = protocol_encode(msg, sTCPSend + sTCPSendSize, NETWORK_BUFFER_SIZE - sTCPSendSize);
+  if (size == 0) {
+    tcp_flush();
+    size = protocol_encode(msg, sTCPSend, NETWORK_BUFFER_SIZE);
+  }
+  SDL_assert(size > 0);
+  metrics_count_sent(msg->type, size);
+  sTCPSendSize += size;
 }
 
 // ============================================================================
 // receive data from the remote node by using the TCP socket.
 static void tcp_receive()
 {
-  // get the incoming stream data from the TCP socket.
-  int bytes = SDLNet_TCP_Recv(sTCPsocket, sTCPRecv, NETWORK_BUFFER_SIZE);
+  // receive the incoming stream data directly into the free space of the ring.
+  Uint8* space = NULL;
+  int capacity = ring_reserve(&sTCPStream, &space);
+  SDL_assert(capacity > 0);
+  int bytes = SDLNet_TCP_Recv(sTCPsocket, space, capacity);
   if (bytes <= 0) {
     printf("The connection to the remote node was lost.\n");
     exit(EXIT_FAILURE);
   }
-
-  // process the received data stream.
-  for (int i = 0; i < bytes; i++) {
-    if (sTCPRecv[i] == '|') {
-      if (sStreamCursor > 0) {
-        char* token = strtok(sStreamBuffer, ":");
-        if (strncmp(token, "ping", 4) == 0) {
-          // get the ping time from the request.
-          token = strtok(NULL, ":");
-          int t0 = atoi(token);
-
-          // send a pong response back to requester.
-          ping_send_response(t0);
-        } else if (strncmp(token, "pong", 4) == 0) {
-          // get ping and pong times.
-          token = strtok(NULL, ":");
-          int t0 = atoi(token);
-          token = strtok(NULL, ":");
-          int t1 = atoi(token);
-
-          // calculate latency and delta to adjust clock offset and remote lag.
-          int t2 = get_ticks();
-          int rtt = (t2 - t0);
-          int lag = (rtt / 2);
-          sRemoteLag = lag + (50 - (lag % 50));
-          if (sMode == SERVER) {
-            printf("rtt:%d remoteLag:%d\n", rtt, sRemoteLag);
-          } else {
-            int cc = ((t1 - t0) + (t1 - t2)) / 2;
-            sTickOffset += cc;
-            printf("rtt:%d remoteLag:%d cc:%d co:%d\n", rtt, sRemoteLag, cc, sTickOffset);
-          }
-        } else if (strncmp(token, "left", 4) == 0) {
-          // get time, x and y positions.
-          token = strtok(NULL, ":");
-          int t = atoi(token);
-          token = strtok(NULL, ":");
-          int x = atoi(token);
-          token = strtok(NULL, ":");
-          int y = atoi(token);
-
-          // create a new state and assign it to states array.
-          SDL_Rect rect = {x, y, PADDLE_WIDTH, PADDLE_HEIGHT };
-          state_set(&sLeftPaddle, &rect, t);
-        } else if (strncmp(token, "right", 5) == 0) {
-          // get time, x and y positions.
-          token = strtok(NULL, ":");
-          int t = atoi(token);
-          token = strtok(NULL, ":");
-          int x = atoi(token);
-          token = strtok(NULL, ":");
-          int y = atoi(token);
-
-          // create a new state and assign it to states array.
-          SDL_Rect rect = {x, y, PADDLE_WIDTH, PADDLE_HEIGHT };
-          state_set(&sRightPaddle, &rect, t);
-        } else if (strncmp(token, "ball", 4) == 0) {
-          // get time, x and y positions.
-          token = strtok(NULL, ":");
-          int t = atoi(token);
-          token = strtok(NULL, ":");
-          int x = atoi(token);
-          token = strtok(NULL, ":");
-          int y = atoi(token);
-          token = strtok(NULL, ":");
-          int dirX = atoi(token);
-          token = strtok(NULL, ":");
-          int dirY = atoi(token);
-          token = strtok(NULL, ":");
-          int velocity = atoi(token);
-
-          // check if we need to correct the position and direction of the ball.
-          SDL_Rect rect = {x, y, BALL_WIDTH, BALL_HEIGHT };
-          SDL_Rect usedRect = state_get(&sBall, t);
-          if (usedRect.x != rect.x || usedRect.y != rect.y
-            || dirX != sBall.direction_x || dirY != sBall.direction_y
-            || velocity != sBall.velocity) {
-            state_clear(&sBall, &rect, t);
-            state_set(&sBall, &rect, t);
-            sBall.direction_x = dirX;
-            sBall.direction_y = dirY;
-            sBall.velocity = velocity;
-          }
-        } else if (strncmp(token, "reset", 5) == 0) {
-          SDL_assert(sMode == CLIENT);
-
-          // get time, countdown, ball directions and points.
-          token = strtok(NULL, ":");
-          int t = atoi(token);
-          token = strtok(NULL, ":");
-          sCountdown = atoi(token);
-          token = strtok(NULL, ":");
-          int x = atoi(token);
-          token = strtok(NULL, ":");
-          int y = atoi(token);
-          token = strtok(NULL, ":");
-          sLeftPoints = atoi(token);
-          token = strtok(NULL, ":");
-          sRightPoints = atoi(token);
-
-          // assign ball directions.
-          sBall.direction_x = x;
-          sBall.direction_y = y;
-
-          // perform a client reset.
-          reset_client(t);
-        } else if (strncmp(token, "goal", 4) == 0) {
-          SDL_assert(sMode == SERVER);
-          give_point(0);
-          reset_server(get_ticks());
-        } else if (strncmp(token, "end-ok", 6) == 0) {
-          SDL_assert(sMode == SERVER);
-          sEndCountdown = get_ticks_without_offset() + END_COUNTDOWN_MS;
-        } else if (strncmp(token, "end", 3) == 0) {
-          SDL_assert(sMode == CLIENT);
-          sEndCountdown = get_ticks_without_offset() + END_COUNTDOWN_MS;
-          tcp_send("end-ok");
-        }
-        memset(sStreamBuffer, 0, NETWORK_BUFFER_SIZE);
-        sStreamCursor = 0;
-      }
-    } else {
-      sStreamBuffer[sStreamCursor] = sTCPRecv[i];
-      sStreamCursor++;
-    }
+  ring_commit(&sTCPStream, bytes);
+
+  // process all complete messages from the received data stream.
+  Message msg;
+  int result = 0;
+  while ((result = ring_next_message(&sTCPStream, &msg)) > 0) {
+    metrics_count_received(msg.type, result);
+    match_dispatch(&sMatch, &msg);
+  }
+  if (result < 0) {
+    printf("Received a malformed TCP message.\n");
+    exit(EXIT_FAILURE);
   }
 }
 
 // ============================================================================
-// render a point on the screen.
-static void render_point(const SDL_Rect pointParts[8], int points)
+// wait until any of the sockets has incoming data or the timeout (ms) expires.
+static int socket_wait(int timeout)
 {
-  SDL_assert(pointParts != NULL);
-  SDL_assert(points >= 0);
-  switch (points) {
-    case 0:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[3]);
-      SDL_RenderFillRect(sRenderer, &pointParts[4]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    case 1:
-      SDL_RenderFillRect(sRenderer, &pointParts[7]);
-      break;
-    case 2:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[4]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      break;
-    case 3:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    case 4:
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[3]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    case 5:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[3]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    case 6:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[3]);
-      SDL_RenderFillRect(sRenderer, &pointParts[4]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    case 7:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    case 8:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[3]);
-      SDL_RenderFillRect(sRenderer, &pointParts[4]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
-    default:
-      SDL_RenderFillRect(sRenderer, &pointParts[0]);
-      SDL_RenderFillRect(sRenderer, &pointParts[1]);
-      SDL_RenderFillRect(sRenderer, &pointParts[2]);
-      SDL_RenderFillRect(sRenderer, &pointParts[3]);
-      SDL_RenderFillRect(sRenderer, &pointParts[5]);
-      SDL_RenderFillRect(sRenderer, &pointParts[6]);
-      break;
+  int result = SDLNet_CheckSockets(sSocketSet, timeout);
+  if (result == -1) {
+    printf("SDLNet_CheckSockets: %s\n", SDLNet_GetError());
   }
+  return result;
 }
 
 // ============================================================================
-// render and present all game objects on the screen.
-static void render(int time)
+// start a simulated communication with the in-process remote match.
+static void sim_start()
 {
-  // resolve the current position of each dynamic game object.
-  SDL_Rect leftPaddle = state_get(&sLeftPaddle, time);
-  SDL_Rect rightPaddle = state_get(&sRightPaddle, time);
-  SDL_Rect ball = state_get(&sBall, time);
-
-  // clear the backbuffer with the black color.
-  SDL_SetRenderDrawColor(sRenderer, 0x00, 0x00, 0x00, 0x00);
-  SDL_RenderClear(sRenderer);
-
-  // render all game objects on the backbuffer.
-  SDL_SetRenderDrawColor(sRenderer, 0xff, 0xff, 0xff, 0xff);
-  SDL_RenderFillRect(sRenderer, &TOP_WALL);
-  SDL_RenderFillRect(sRenderer, &BOTTOM_WALL);
-  SDL_RenderFillRects(sRenderer, CENTER_LINE, 15);
-  SDL_RenderFillRect(sRenderer, &leftPaddle);
-  SDL_RenderFillRect(sRenderer, &rightPaddle);
-  SDL_RenderFillRect(sRenderer, &ball);
-
-  // render point indicators.
-  render_point(SCORE_LEFT_PARTS, sLeftPoints);
-  render_point(SCORE_RIGHT_PARTS, sRightPoints);
-
-  // swap backbuffer to front and vice versa.
-  SDL_RenderPresent(sRenderer);
+  SDL_assert(sTransport == NETSIM);
+
+  netsim_link_init(&sSimLinks[0], 0);
+  netsim_link_init(&sSimLinks[1], 1);
+  netsim_node_init(&sSimNode, &sMatch, &sSimLinks[0], &sSimLinks[1]);
+  netsim_node_init(&sSimPeerNode, &sSimPeer, &sSimLinks[1], &sSimLinks[0]);
+  printf("Simulating the remote %s within the process.\n", (sMode == SERVER ? "client" : "server"));
+
+  // the remote match starts right away as there is nothing to connect. its bot gets
+  // another seed than the local bot so the bots do not make the same errors.
+  bot_init(&sSimPeerBot, sBotReaction, sBotError, ~netsim_get_config()->seed);
+  match_start(&sSimPeer);
+  sSimPeerAccumulator = 0;
+  sSimPeerTicks = match_get_time_source()();
 }
 
 // ============================================================================
-// update all game objects in a node specific way.
-static void update(int time)
+// advance the match by running all due fixed steps of the accumulated time.
+static void advance(Match* match, int* deltaAccumulator, int dt)
 {
-  // resolve the current position of each dynamic game object.
-  SDL_Rect left = state_get(&sLeftPaddle, sPreviousTick);
-  SDL_Rect right = state_get(&sRightPaddle, sPreviousTick);
-  SDL_Rect ball = state_get(&sBall, sPreviousTick);
-
-  // update the left paddle whether it's being owned and actually moving.
-  if (sLeftPaddle.owned == 1 && sLeftPaddle.direction_y != NONE) {
-    // move the paddle based on the movement direction.
-    left.y += sLeftPaddle.velocity * sLeftPaddle.direction_y;
-
-    // ensure that the top and bottom wall boundaries are honoured.
-    if (SDL_HasIntersection(&left, &TOP_WALL)) {
-      left.y = (TOP_WALL.y + TOP_WALL.h);
-    } else if (SDL_HasIntersection(&left, &BOTTOM_WALL)) {
-      left.y = (BOTTOM_WALL.y - PADDLE_HEIGHT);
-    }
-
-    // update the local state with the new position.
-    state_set(&sLeftPaddle, &left, time);
-
-    // send a state update about the movement to remote node.
-    char buffer[NETWORK_BUFFER_SIZE];
-    snprintf(buffer, NETWORK_BUFFER_SIZE, "left:%d:%d:%d", time, left.x, left.y);
-    net_send(buffer);
+  // each step is stamped with the synchronized time when it became due.
+  int time = match_ticks(match);
+  *deltaAccumulator += dt;
+  for (int steps = 0; steps < sMaxSteps && *deltaAccumulator >= TIMESTEP; steps++) {
+    *deltaAccumulator -= TIMESTEP;
+    int stepTime = time - *deltaAccumulator;
+    Uint64 started = metrics_now();
+    match_update(match, stepTime);
+    metrics_observe_since(METRIC_UPDATE_TIME, started);
+    match->previous_tick = stepTime;
   }
 
-  // update the right paddle whether it's being owned and actually moving.
-  if (sRightPaddle.owned == 1 && sRightPaddle.direction_y != NONE) {
-    // move the paddle based on the movement direction.
-    right.y += sRightPaddle.velocity * sRightPaddle.direction_y;
-
-    // ensure that the top and bottom wall boundaries are honoured.
-    if (SDL_HasIntersection(&right, &TOP_WALL)) {
-      right.y = (TOP_WALL.y + TOP_WALL.h);
-    } else if (SDL_HasIntersection(&right, &BOTTOM_WALL)) {
-      right.y = (BOTTOM_WALL.y - PADDLE_HEIGHT);
-    }
-
-    // update the local state with the new position.
-    state_set(&sRightPaddle, &right, time);
+  // drop the backlog of a long hitch instead of trying to catch it up.
+  if (*deltaAccumulator >= TIMESTEP) {
+    *deltaAccumulator %= TIMESTEP;
+  }
+}
 
-    // send a state update about the movement to remote node.
-    char buffer[NETWORK_BUFFER_SIZE];
-    snprintf(buffer, NETWORK_BUFFER_SIZE, "right:%d:%d:%d", time, right.x, right.y);
-    net_send(buffer);
+// ============================================================================
+// send the local batch and run the in-process remote match with its own batch.
+static void sim_flush()
+{
+  SDL_assert(sTransport == NETSIM);
+  int ticks = match_get_time_source()();
+  netsim_node_flush(&sSimNode, ticks);
+
+  int dt = ticks - sSimPeerTicks;
+  sSimPeerTicks = ticks;
+  if (sSimPeer.state == RUNNING) {
+    // the remote paddle is always controlled by a bot.
+    DynamicObject* paddle = (sSimPeer.mode == SERVER ? &sSimPeer.left_paddle : &sSimPeer.right_paddle);
+    paddle->direction_y = bot_input(&sSimPeerBot, &sSimPeer, paddle, match_ticks(&sSimPeer));
+    match_poll(&sSimPeer);
+    advance(&sSimPeer, &sSimPeerAccumulator, dt);
+    netsim_node_flush(&sSimPeerNode, ticks);
   }
+}
 
-  // update the movement of the ball.
-  if (sBall.velocity != 0) {
-    // move the ball based on the movement direction.
-    ball.y += sBall.velocity * sBall.direction_y;
-    ball.x += sBall.velocity * sBall.direction_x;
-
-    // check whether the ball hits top or bottom walls.
-    if (SDL_HasIntersection(&ball, &TOP_WALL)) {
-      ball.y = (TOP_WALL.y + TOP_WALL.h);
-      sBall.direction_y *= -1;
-    } else if (SDL_HasIntersection(&ball, &BOTTOM_WALL)) {
-      ball.y = (BOTTOM_WALL.y - ball.h);
-      sBall.direction_y *= -1;
-    }
+// ============================================================================
+// deliver the due simulated packets to the local and the remote match.
+static void sim_receive()
+{
+  SDL_assert(sTransport == NETSIM);
+  int ticks = match_get_time_source()();
+  netsim_node_receive(&sSimNode, ticks);
+  netsim_node_receive(&sSimPeerNode, ticks);
+}
 
-    // check paddle collisions and send updates when required.
-    if (SDL_HasIntersection(&left, &ball)) {
-      ball.x = (left.x + left.w);
-      sBall.direction_x *= -1;
-      sBall.velocity += BALL_VELOCITY_INCREMENT;
-      if (sLeftPaddle.owned == 1) {
-        // send a state update about the movement to remote node.
-        char buffer[NETWORK_BUFFER_SIZE];
-        snprintf(buffer,
-          NETWORK_BUFFER_SIZE,
-          "ball:%d:%d:%d:%d:%d:%d",
-          time,
-          ball.x,
-          ball.y,
-          sBall.direction_x,
-          sBall.direction_y,
-          sBall.velocity);
-        net_send(buffer);
-      }
-    } else if (SDL_HasIntersection(&right, &ball)) {
-      ball.x = (right.x - ball.w);
-      sBall.direction_x *= -1;
-      sBall.velocity += BALL_VELOCITY_INCREMENT;
-      if (sRightPaddle.owned == 1) {
-        // send a state update about the movement to remote node.
-        char buffer[NETWORK_BUFFER_SIZE];
-        snprintf(buffer,
-          NETWORK_BUFFER_SIZE,
-          "ball:%d:%d:%d:%d:%d:%d",
-          time,
-          ball.x,
-          ball.y,
-          sBall.direction_x,
-          sBall.direction_y,
-          sBall.velocity);
-        net_send(buffer);
-      }
-    }
+// ============================================================================
+// sleep until a simulated packet is delivered or the timeout (ms) expires.
+static int sim_wait(int timeout)
+{
+  // a stopped match never receives its due packets, so its link is not waited for.
+  const NetSimLink* links[2];
+  int count = 0;
+  if (sSimPeer.state == RUNNING) {
+    links[count++] = &sSimLinks[0];
+  }
+  if (sMatch.state == RUNNING) {
+    links[count++] = &sSimLinks[1];
+  }
 
-    // check whether the ball hit a goal (decide on a owner side).
-    if (sLeftPaddle.owned == 1) {
-      if (SDL_HasIntersection(&ball, &LEFT_GOAL)) {
-        give_point(1);
-        reset_server(time);
-        return;
-      }
-    } else {
-      if (SDL_HasIntersection(&ball, &RIGHT_GOAL)) {
-        net_send("goal");
-        reset_client(time);
-        return;
-      }
+  time_source_func source = match_get_time_source();
+  int ticks = source();
+  for (int i = 0; i < count; i++) {
+    int wait = netsim_link_wait(links[i], ticks);
+    timeout = (wait >= 0 ? SDL_min(timeout, wait) : timeout);
+  }
+  if (timeout > 0 && source == &sim_clock) {
+    sSimClock += timeout;
+  } else if (timeout > 0) {
+    SDL_Delay(timeout);
+  }
+  ticks = source();
+  for (int i = 0; i < count; i++) {
+    if (netsim_link_wait(links[i], ticks) == 0) {
+      return 1;
     }
-
-    // update the local state with the new position.
-    state_set(&sBall, &ball, time);
   }
+  return 0;
 }
 
 // ============================================================================
-// get the current tick time without any offsets.
-static int get_ticks_without_offset()
+// get the virtual time (ms) of a headless simulated match (advanced only by waiting).
+static Uint32 sim_clock()
 {
-  return SDL_GetTicks();
+  return sSimClock;
 }
 
 // ============================================================================
-// get the current tick time along with any time offset.
-static int get_ticks()
+// gather the rects of a score number into the given array and return their amount.
+static int gather_point(const SDL_Rect pointParts[8], int points, SDL_Rect* rects)
 {
-  return SDL_GetTicks() + sTickOffset;
+  SDL_assert(pointParts != NULL);
+  SDL_assert(points >= 0);
+  Uint8 parts = SCORE_DIGIT_PARTS[SDL_min(points, 9)];
+  int count = 0;
+  for (int i = 0; i < 8; i++) {
+    if (parts & (1 << i)) {
+      rects[count++] = pointParts[i];
+    }
+  }
+  return count;
 }
 
 // ============================================================================
-// send a ping request message to the remote node.
-static void ping_send_request()
+// render the static walls and the center line into the background texture.
+static void render_background()
 {
-  char buffer[NETWORK_BUFFER_SIZE];
-  SDL_snprintf(buffer, NETWORK_BUFFER_SIZE, "ping:%d", get_ticks());
-  net_send(buffer);
+  if (sBackground == NULL) {
+    return;
+  }
+  SDL_SetRenderTarget(sRenderer, sBackground);
+  SDL_SetRenderDrawColor(sRenderer, 0x00, 0x00, 0x00, 0x00);
+  SDL_RenderClear(sRenderer);
+  SDL_SetRenderDrawColor(sRenderer, 0xff, 0xff, 0xff, 0xff);
+  SDL_RenderFillRect(sRenderer, &TOP_WALL);
+  SDL_RenderFillRect(sRenderer, &BOTTOM_WALL);
+  SDL_RenderFillRects(sRenderer, CENTER_LINE, 15);
+  SDL_SetRenderTarget(sRenderer, NULL);
 }
 
 // ============================================================================
-// send a ping response message (pong) to the remote node.
-static void ping_send_response(int ping)
+// draw the static objects and the given dynamic object rects and present the frame.
+static void draw_frame(SDL_Rect rects[RENDER_MAX_RECTS], int count)
 {
-  char buffer[NETWORK_BUFFER_SIZE];
-  snprintf(buffer, NETWORK_BUFFER_SIZE, "pong:%d:%d", ping, get_ticks());
-  net_send(buffer);
+  // copy the cached background or draw the static objects without one.
+  if (sBackground != NULL) {
+    SDL_RenderCopy(sRenderer, sBackground, NULL, NULL);
+  } else {
+    SDL_SetRenderDrawColor(sRenderer, 0x00, 0x00, 0x00, 0x00);
+    SDL_RenderClear(sRenderer);
+    rects[count++] = TOP_WALL;
+    rects[count++] = BOTTOM_WALL;
+    for (int i = 0; i < 15; i++) {
+      rects[count++] = CENTER_LINE[i];
+    }
+  }
+
+  // render all dynamic objects with a single call.
+  SDL_SetRenderDrawColor(sRenderer, 0xff, 0xff, 0xff, 0xff);
+  SDL_RenderFillRects(sRenderer, rects, count);
+
+  // swap backbuffer to front and vice versa.
+  Uint64 traced = trace_begin();
+  SDL_RenderPresent(sRenderer);
+  trace_end("render", "present", traced);
 }
 
 // ============================================================================
-// get a random vertical direction (UP / DOWN)
-static int random_vertical_direction()
+// dump the presented offscreen frame and compare it with its golden frame.
+static void capture_frame(int index)
 {
-  return (rand() % 2) == 0 ? UP : DOWN;
+  if (sSurface == NULL) {
+    return;
+  }
+  if (sDumpPath != NULL && frame_save(sSurface, sDumpPath, index) != 0) {
+    printf("Unable to save frame %d into %s: %s\n", index, sDumpPath, SDL_GetError());
+    exit(EXIT_FAILURE);
+  }
+  if (sGoldenPath != NULL) {
+    int differences = frame_compare(sSurface, sGoldenPath, index);
+    if (differences != 0) {
+      printf("Frame %d differs from its golden frame (%d pixels)\n", index, differences);
+      sFrameMismatches++;
+    }
+  }
 }
 
 // ============================================================================
-// get a random horizontal direction (LEFT / RIGHT).
-static int random_horizontal_direction()
+// render and present all game objects on the screen when any of them has changed.
+static void render(float alpha)
 {
-  return (rand() % 2) == 0 ? LEFT : RIGHT;
+  // resolve the position of each dynamic game object between the ticks.
+  int time = sMatch.previous_tick + (int)(alpha * TIMESTEP);
+  SDL_Rect rects[RENDER_MAX_RECTS];
+  int count = 0;
+  rects[count++] = state_view(&sMatch, &sMatch.left_paddle, time);
+  rects[count++] = state_view(&sMatch, &sMatch.right_paddle, time);
+  rects[count++] = state_view(&sMatch, &sMatch.ball, time);
+  count += gather_point(SCORE_LEFT_PARTS, sMatch.left_points, rects + count);
+  count += gather_point(SCORE_RIGHT_PARTS, sMatch.right_points, rects + count);
+
+  // skip the frame when nothing visible has changed and the heartbeat is not due.
+  int now = SDL_GetTicks();
+  if (sRedraw == 0
+    && sRenderHeartbeat > 0
+    && now - sPresentedTicks < sRenderHeartbeat
+    && count == sPresentedCount
+    && SDL_memcmp(rects, sPresentedRects, count * sizeof(SDL_Rect)) == 0) {
+    sSkippedFrames++;
+    return;
+  }
+  SDL_memcpy(sPresentedRects, rects, count * sizeof(SDL_Rect));
+  sPresentedCount = count;
+  sPresentedTicks = now;
+  sRedraw = 0;
+
+  draw_frame(rects, count);
+  capture_frame(sPresentedFrames++);
 }
 
 // ============================================================================
-// reset the game (except points) at the client side.
-static void reset_client(int time)
+// get the position of a deterministic back and forth movement for the given frame.
+static int bench_sweep(int frame, int frames, int min, int max)
 {
-  SDL_assert(sMode == CLIENT);
-
-  // clear all possible future states from the dynamic objects.
-  state_clear(&sRightPaddle, &RIGHT_PADDLE_START, time);
-  state_clear(&sLeftPaddle, &LEFT_PADDLE_START, time);
-  state_clear(&sBall, &BALL_START, time);
-
-  // reset dynamic objects back to their starting positions.
-  state_set(&sRightPaddle, &RIGHT_PADDLE_START, time);
-  state_set(&sLeftPaddle, &LEFT_PADDLE_START, time);
-  state_set(&sBall, &BALL_START, time);
-
-  // reset ball velocity back to initial velocity.
-  sBall.velocity = BALL_INITIAL_VELOCITY;
+  int phase = frame % (2 * frames);
+  int step = (phase < frames ? phase : 2 * frames - phase);
+  return min + (max - min) * step / frames;
 }
 
 // ============================================================================
-// reset the game (except points) at the server side.
-static void reset_server(int time)
+// render a deterministic sequence of frames and report the average render times.
+static void run_render_bench()
 {
-  SDL_assert(sMode == SERVER);
-
-  // clear all possible future states from the dynamic objects.
-  state_clear(&sRightPaddle, &RIGHT_PADDLE_START, time);
-  state_clear(&sLeftPaddle, &LEFT_PADDLE_START, time);
-  state_clear(&sBall, &BALL_START, time);
-
-  // reset dynamic objects back to their starting positions.
-  state_set(&sRightPaddle, &RIGHT_PADDLE_START, time);
-  state_set(&sLeftPaddle, &LEFT_PADDLE_START, time);
-  state_set(&sBall, &BALL_START, time);
-
-  // reset ball velocity back to initial velocity.
-  sBall.velocity = BALL_INITIAL_VELOCITY;
-
-  // assign a countdown to prevent ball from launching immediately.
-  sCountdown = time + COUNTDOWN_MS;
-
-  // randomize new horizontal- and vertical directions for the ball.
-  sBall.direction_x = random_horizontal_direction();
-  sBall.direction_y = random_vertical_direction();
-
-  // send the reset command to client as well.
-  char buffer[NETWORK_BUFFER_SIZE];
-  snprintf(buffer,
-    NETWORK_BUFFER_SIZE,
-    "reset:%d:%d:%d:%d:%d:%d",
-    time, sCountdown, sBall.direction_x, sBall.direction_y,
-    sLeftPoints, sRightPoints);
-  net_send(buffer);
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  Uint64 renderTicks = 0;
+  Uint64 gatherTicks = 0;
+  for (int i = 0; i < sBenchFrames; i++) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // move the paddles and the ball across the field and advance the scores.
+    SDL_Rect rects[RENDER_MAX_RECTS];
+    int count = 0;
+    int paddleY = bench_sweep(i, BENCH_PADDLE_FRAMES, BOX, RESOLUTION_HEIGHT - BOX - PADDLE_HEIGHT);
+    rects[count++] = (SDL_Rect) { PADDLE_EDGE_OFFSET, paddleY, PADDLE_WIDTH, PADDLE_HEIGHT };
+    rects[count++] = (SDL_Rect) {
+      RESOLUTION_WIDTH - PADDLE_EDGE_OFFSET - PADDLE_WIDTH,
+      RESOLUTION_HEIGHT - PADDLE_HEIGHT - paddleY,
+      PADDLE_WIDTH,
+      PADDLE_HEIGHT };
+    rects[count++] = (SDL_Rect) {
+      bench_sweep(i, BENCH_BALL_FRAMES, 0, RESOLUTION_WIDTH - BALL_WIDTH),
+      bench_sweep(i, BENCH_BALL_FRAMES * 2 / 3, BOX, RESOLUTION_HEIGHT - BOX - BALL_HEIGHT),
+      BALL_WIDTH,
+      BALL_HEIGHT };
+    Uint64 gatherStart = SDL_GetPerformanceCounter();
+    count += gather_point(SCORE_LEFT_PARTS, (i / BENCH_BALL_FRAMES) % 10, rects + count);
+    count += gather_point(SCORE_RIGHT_PARTS, (i / BENCH_PADDLE_FRAMES) % 10, rects + count);
+    gatherTicks += SDL_GetPerformanceCounter() - gatherStart;
+
+    draw_frame(rects, count);
+    renderTicks += SDL_GetPerformanceCounter() - start;
+    capture_frame(i);
+  }
+  printf("render-bench: %d frames, render %.3f us/frame, gather_point %.3f us/frame\n",
+    sBenchFrames,
+    (double)renderTicks * 1000000.0 / frequency / sBenchFrames,
+    (double)gatherTicks * 1000000.0 / frequency / sBenchFrames);
 }
 
 // ============================================================================
@@ -1341,69 +1224,68 @@ static void reset_server(int time)
 static void run()
 {
   net_start();
-  ping_send_request();
+  match_start(&sMatch);
 
+  // the loop follows the time source of the match (a virtual clock for a headless simulation).
+  time_source_func source = match_get_time_source();
   int deltaAccumulator = 0;
-  int ticks = get_ticks_without_offset();
+  int ticks = source();
   int previousTicks = ticks;
+  int nextFrameTicks = ticks;
+  int frameTime = (sTargetFps > 0 ? 1000 / sTargetFps : 0);
+  Uint64 previousFrame = 0;
 
-  if (sMode == SERVER) {
-    reset_server(ticks);
-  }
+  // the paddle controlled by the local player.
+  DynamicObject* paddle = (sMode == SERVER ? &sMatch.left_paddle : &sMatch.right_paddle);
 
   SDL_Event event;
-  while (sState == RUNNING) {
+  while (sMatch.state == RUNNING) {
     // get a ticks time and calculate delta.
-    ticks = get_ticks_without_offset();
+    ticks = source();
     int dt = (ticks - previousTicks);
     previousTicks = ticks;
 
     // retrieve and handle core SDL events
+    Uint64 traced = trace_begin();
     while(SDL_PollEvent(&event) != 0) {
       switch (event.type) {
         case SDL_QUIT:
-          sState = STOPPED;
+          sMatch.state = STOPPED;
+          break;
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+          render_background();
+          sRedraw = 1;
+          break;
+        case SDL_WINDOWEVENT:
+          if (event.window.event == SDL_WINDOWEVENT_EXPOSED
+            || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            sRedraw = 1;
+          }
           break;
         case SDL_KEYDOWN:
           switch (event.key.keysym.sym) {
             case SDLK_UP:
-              if (sMode == SERVER) {
-                sLeftPaddle.direction_y = UP;
-              } else {
-                sRightPaddle.direction_y = UP;
-              }
+              paddle->direction_y = UP;
               break;
             case SDLK_DOWN:
-              if (sMode == SERVER) {
-                sLeftPaddle.direction_y = DOWN;
-              } else {
-                sRightPaddle.direction_y = DOWN;
-              }
+              paddle->direction_y = DOWN;
+              break;
+            case SDLK_F12:
+              trace_flush();
               break;
           }
           break;
         case SDL_KEYUP:
           switch (event.key.keysym.sym) {
             case SDLK_UP:
-              if (sMode == SERVER) {
-                if (sLeftPaddle.direction_y == UP) {
-                  sLeftPaddle.direction_y = NONE;
-                }
-              } else {
-                if (sRightPaddle.direction_y == UP) {
-                  sRightPaddle.direction_y = NONE;
-                }
+              if (paddle->direction_y == UP) {
+                paddle->direction_y = NONE;
               }
               break;
             case SDLK_DOWN:
-              if (sMode == SERVER) {
-                if (sLeftPaddle.direction_y == DOWN) {
-                  sLeftPaddle.direction_y = NONE;
-                }
-              } else {
-                if (sRightPaddle.direction_y == DOWN) {
-                  sRightPaddle.direction_y = NONE;
-                }
+              if (paddle->direction_y == DOWN) {
+                paddle->direction_y = NONE;
               }
               break;
           }
@@ -1411,44 +1293,99 @@ static void run()
       }
     }
 
-    // check whether it's time to end the game.
-    if (sEndCountdown <= ticks) {
-      sState = STOPPED;
+    trace_end("loop", "events", traced);
+
+    // check whether it's time to end the game and send pings.
+    traced = trace_begin();
+    match_poll(&sMatch);
+    trace_end("loop", "poll", traced);
+    if (sMatch.state != RUNNING) {
       break;
     }
 
-    // peek to sockets and process the incoming data.
-    int socketState = SDLNet_CheckSockets(sSocketSet, 0);
+    // sleep on the sockets until the next tick or frame is due. incoming data
+    // wakes the loop immediately to process it without any extra latency.
+    int timeout = SDL_max(0, TIMESTEP - (deltaAccumulator + dt));
+    if (sHeadless == 0) {
+      timeout = (frameTime > 0 ? SDL_min(timeout, SDL_max(0, nextFrameTicks - ticks)) : 0);
+    }
+    traced = trace_begin();
+    int socketState = net_wait(timeout);
+    trace_end("loop", "wait", traced);
     if (socketState == -1) {
-      printf("SDLNet_CheckSockets: %s\n", SDLNet_GetError());
       perror("SDLNet_CheckSockets");
       break;
     } else if (socketState > 0) {
+      traced = trace_begin();
       net_receive();
+      trace_end("loop", "receive", traced);
     }
 
-    // send ping request with the predefined interval.
-    if (sNextPingTicks <= ticks) {
-      ping_send_request();
-      sNextPingTicks = get_ticks_without_offset() + NETWORK_PING_INTERVAL;
+    // let the bot steer the local paddle instead of the keyboard when enabled.
+    traced = trace_begin();
+    if (sBotEnabled == 1) {
+      paddle->direction_y = bot_input(&sBot, &sMatch, paddle, match_ticks(&sMatch));
     }
 
-    // update game logics with a fixed framerate.
-    int time = get_ticks();
-    deltaAccumulator += dt;
-    if (deltaAccumulator >= TIMESTEP) {
-      if (sCountdown <= time) {
-        update(time);
+    // update game logics with a fixed framerate by running all due steps.
+    advance(&sMatch, &deltaAccumulator, dt);
+    trace_end("loop", "update", traced);
+
+    // send all messages produced during this tick as a single batch.
+    traced = trace_begin();
+    net_flush();
+    trace_end("loop", "flush", traced);
+
+    // publish the metrics to the stats file and the HTTP endpoint when requested.
+    traced = trace_begin();
+    metrics_poll();
+    trace_end("loop", "metrics", traced);
+
+    // render only when the next frame is due with the target frame rate.
+    int now = source();
+    if (sHeadless == 0 && now >= nextFrameTicks) {
+      Uint64 renderStart = metrics_now();
+      if (previousFrame != 0) {
+        metrics_observe_since(METRIC_FRAME_INTERVAL, previousFrame);
+      }
+      previousFrame = renderStart;
+      traced = trace_begin();
+      render((float)deltaAccumulator / TIMESTEP);
+      trace_end("loop", "render", traced);
+      metrics_observe_since(METRIC_RENDER_TIME, renderStart);
+      nextFrameTicks += frameTime;
+      if (nextFrameTicks < now) {
+        nextFrameTicks = now + frameTime;
       }
-      deltaAccumulator -= TIMESTEP;
     }
-    render(time);
-    sPreviousTick = time;
   }
   if (sTransport == UDP) {
-    net_send("quit");
+    // give the remote node a moment to acknowledge the quit message.
+    Message msg = { .type = MESSAGE_QUIT };
+    sMatch.net_send(&sMatch, &msg);
+    udp_wait_acks(NETWORK_LINGER_TIME);
+  }
+  printf("game ended with results %d - %d\n", sMatch.left_points, sMatch.right_points);
+  if (sHeadless == 0) {
+    printf("frames: %d presented, %d skipped\n", sPresentedFrames, sSkippedFrames);
+  }
+  if (sFrameMismatches > 0) {
+    printf("%d frame(s) differed from their golden frames\n", sFrameMismatches);
+    exit(EXIT_FAILURE);
+  }
+  if (sTransport == NETSIM) {
+    printf("simulated remote game ended with results %d - %d\n", sSimPeer.left_points,
+      sSimPeer.right_points);
+    for (int i = 0; i < 2; i++) {
+      printf("%s link: %d sent, %d lost, %d duplicated, %d reordered\n",
+        (i == 0 ? "outgoing" : "incoming"), sSimLinks[i].sent, sSimLinks[i].lost,
+        sSimLinks[i].duplicated, sSimLinks[i].reordered);
+    }
+  }
+  if (sMatch.snapshots.keyframes + sMatch.snapshots.deltas > 0) {
+    printf("snapshots: %d keyframes, %d deltas, %d bytes\n", sMatch.snapshots.keyframes,
+      sMatch.snapshots.deltas, sMatch.snapshots.bytes);
   }
-  printf("game ended with results %d - %d\n", sLeftPoints, sRightPoints);
 }
 
 // ============================================================================
@@ -1456,6 +1393,16 @@ static void run()
 int main(int argc, char* argv[])
 {
   initialize(argc, argv);
-  run();
+  if (sBenchFrames > 0) {
+    run_render_bench();
+    if (sFrameMismatches > 0) {
+      printf("%d frame(s) differed from their golden frames\n", sFrameMismatches);
+      return EXIT_FAILURE;
+    }
+  } else if (sMulti == 1) {
+    server_run(sTransport, sWorkers);
+  } else {
+    run();
+  }
   return EXIT_SUCCESS;
 }
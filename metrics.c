@@ -0,0 +1,468 @@
+#include "metrics.h"
+#include "protocol.h"
+
+#include <SDL/SDL_net.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+
+typedef struct {
+  // the name of the metric in the exposition format.
+  const char* name;
+  // the description of the metric.
+  const char* help;
+  // the type of the metric (counter, gauge or histogram).
+  int type;
+  // a definition whether the metric has a series for each message type.
+  int per_type;
+} MetricInfo;
+
+typedef struct {
+  // the wrapping sample counts of the buckets updated by any thread.
+  SDL_atomic_t counts[METRICS_HISTOGRAM_BUCKETS];
+  // the wrapping sum of the samples updated by any thread.
+  SDL_atomic_t sum;
+  // the bucket counts seen by the previous collection.
+  Uint32 seen_counts[METRICS_HISTOGRAM_BUCKETS];
+  // the sum seen by the previous collection.
+  Uint32 seen_sum;
+  // the collected bucket counts which never wrap.
+  Uint64 totals[METRICS_HISTOGRAM_BUCKETS];
+  // the collected sum which never wraps.
+  Uint64 total_sum;
+} Histogram;
+
+// the description of each metric indexed by its id.
+static const MetricInfo METRICS[METRIC_COUNT] = {
+  [METRIC_FRAME_INTERVAL] = { "pong_frame_interval_us", "Interval between rendered frames.", METRIC_HISTOGRAM, 0 },
+  [METRIC_UPDATE_TIME] = { "pong_update_duration_us", "Duration of a single fixed timestep update.", METRIC_HISTOGRAM, 0 },
+  [METRIC_RENDER_TIME] = { "pong_render_duration_us", "Duration of rendering a frame.", METRIC_HISTOGRAM, 0 },
+  [METRIC_TICK_TIME] = { "pong_server_tick_duration_us", "Duration of a server worker tick.", METRIC_HISTOGRAM, 0 },
+  [METRIC_TICK_OVERRUNS] = { "pong_server_tick_overruns_total", "Server worker ticks which missed their deadline.", METRIC_COUNTER, 0 },
+  [METRIC_MATCHES] = { "pong_server_matches", "Matches hosted by the server.", METRIC_GAUGE, 0 },
+  [METRIC_RTT] = { "pong_rtt_ms", "Round-trip time of each ping.", METRIC_HISTOGRAM, 0 },
+  [METRIC_CLOCK_OFFSET] = { "pong_clock_offset_ms", "Offset applied to the local clock.", METRIC_GAUGE, 0 },
+  [METRIC_CLOCK_SKEW] = { "pong_clock_skew_ppm", "Estimated drift of the remote clock.", METRIC_GAUGE, 0 },
+  [METRIC_BALL_CORRECTION] = { "pong_ball_correction_px", "Largest axis distance of each received ball correction.", METRIC_HISTOGRAM, 0 },
+  [METRIC_ROLLBACK_FRAMES] = { "pong_rollback_frames", "Frames simulated again by each rollback.", METRIC_HISTOGRAM, 0 },
+  [METRIC_PREDICTION_CORRECTIONS] = { "pong_prediction_corrections_total", "Predictions changed by an authoritative state.", METRIC_COUNTER, 0 },
+  [METRIC_KEYFRAME_REQUESTS] = { "pong_keyframe_requests_total", "Keyframes requested after an unusable delta.", METRIC_COUNTER, 0 },
+  [METRIC_PACKETS_SENT] = { "pong_packets_sent_total", "Sent UDP packets.", METRIC_COUNTER, 0 },
+  [METRIC_PACKETS_RECEIVED] = { "pong_packets_received_total", "Received UDP packets.", METRIC_COUNTER, 0 },
+  [METRIC_PACKETS_DROPPED] = { "pong_packets_dropped_total", "Duplicated, too old and malformed UDP packets.", METRIC_COUNTER, 0 },
+  [METRIC_PACKETS_LATE] = { "pong_packets_late_total", "UDP packets received after a newer packet.", METRIC_COUNTER, 0 },
+  [METRIC_RETRANSMISSIONS] = { "pong_retransmissions_total", "Reliable message retransmissions.", METRIC_COUNTER, 0 },
+  [METRIC_MESSAGES_SENT] = { "pong_messages_sent_total", "Sent messages.", METRIC_COUNTER, 1 },
+  [METRIC_MESSAGES_RECEIVED] = { "pong_messages_received_total", "Accepted received messages.", METRIC_COUNTER, 1 },
+  [METRIC_BYTES_SENT] = { "pong_message_bytes_sent_total", "Sent message bytes.", METRIC_COUNTER, 1 },
+  [METRIC_BYTES_RECEIVED] = { "pong_message_bytes_received_total", "Accepted received message bytes.", METRIC_COUNTER, 1 }
+};
+
+// the wrapping values of the counters and the values of the gauges for each series.
+static SDL_atomic_t sValues[METRIC_COUNT][MESSAGE_TYPE_COUNT];
+// the counter values seen by the previous collection.
+static Uint32 sSeenValues[METRIC_COUNT][MESSAGE_TYPE_COUNT];
+// the collected counter values which never wrap.
+static Uint64 sTotals[METRIC_COUNT][MESSAGE_TYPE_COUNT];
+// the histograms indexed by the metric id (unused for other metric types).
+static Histogram sHistograms[METRIC_COUNT];
+// the path of the periodically written stats file.
+static const char* sFile = NULL;
+// the time when the stats file is written next.
+static int sNextWrite = 0;
+// the socket listening for HTTP clients.
+static TCPsocket sListener = NULL;
+// the accepted HTTP clients waiting for their request.
+static TCPsocket sClients[METRICS_MAX_CLIENTS];
+// the socket set used to poll the listener and the clients.
+static SDLNet_SocketSet sSocketSet = NULL;
+// the buffer used to format the metrics for the stats file.
+static char sBuffer[METRICS_BUFFER_SIZE];
+// the buffer used to format the metrics for the HTTP clients.
+static char sResponse[METRICS_BUFFER_SIZE];
+// the thread answering the HTTP clients.
+static SDL_Thread* sThread = NULL;
+// a definition whether the HTTP thread should keep running.
+static SDL_atomic_t sServing;
+// the lock guarding the collection when the HTTP thread is running.
+static SDL_mutex* sLock = NULL;
+
+// ============================================================================
+// get the histogram bucket of the value with a logarithmic scale and linear sub-buckets.
+static int bucket_index(Uint32 value)
+{
+  if (value < METRICS_SUB_BUCKETS) {
+    return (int)value;
+  }
+  int exponent = METRICS_SUB_BITS;
+  while ((value >> (exponent + 1)) != 0) {
+    exponent++;
+  }
+  int sub = (int)(value >> (exponent - METRICS_SUB_BITS)) & (METRICS_SUB_BUCKETS - 1);
+  int index = METRICS_SUB_BUCKETS * (exponent - METRICS_SUB_BITS + 1) + sub;
+  return SDL_min(index, METRICS_HISTOGRAM_BUCKETS - 1);
+}
+
+// ============================================================================
+// get the largest value which falls into the given histogram bucket.
+static Uint32 bucket_bound(int index)
+{
+  if (index < METRICS_SUB_BUCKETS) {
+    return (Uint32)index;
+  }
+  int exponent = index / METRICS_SUB_BUCKETS - 1 + METRICS_SUB_BITS;
+  int sub = index % METRICS_SUB_BUCKETS;
+  Uint32 width = (Uint32)1 << (exponent - METRICS_SUB_BITS);
+  return (Uint32)(METRICS_SUB_BUCKETS + sub) * width + width - 1;
+}
+
+// ============================================================================
+// add the change of a wrapping value since the previous collection to its total.
+static void accumulate(SDL_atomic_t* value, Uint32* seen, Uint64* total)
+{
+  Uint32 current = (Uint32)SDL_AtomicGet(value);
+  *total += (Uint32)(current - *seen);
+  *seen = current;
+}
+
+// ============================================================================
+// fold the wrapping values updated by the threads into the totals.
+static void collect()
+{
+  // a collection each second keeps the 32-bit values far from wrapping twice.
+  for (int id = 0; id < METRIC_COUNT; id++) {
+    if (METRICS[id].type == METRIC_COUNTER) {
+      for (int i = 0; i < MESSAGE_TYPE_COUNT; i++) {
+        accumulate(&sValues[id][i], &sSeenValues[id][i], &sTotals[id][i]);
+      }
+    } else if (METRICS[id].type == METRIC_HISTOGRAM) {
+      Histogram* histogram = &sHistograms[id];
+      for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        accumulate(&histogram->counts[i], &histogram->seen_counts[i], &histogram->totals[i]);
+      }
+      accumulate(&histogram->sum, &histogram->seen_sum, &histogram->total_sum);
+    }
+  }
+}
+
+// ============================================================================
+// write the formatted text into the buffer. returns the new length of the text.
+static int append(char* buffer, int size, int length, const char* format, ...)
+{
+  if (length >= size) {
+    return length;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(buffer + length, size - length, format, args);
+  va_end(args);
+  return (written < 0 ? length : SDL_min(size - 1, length + written));
+}
+
+// ============================================================================
+// rewrite the stats file through a temporary file so readers never see a partial file.
+static void write_file()
+{
+  char temporary[FILENAME_MAX];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", sFile);
+  FILE* file = fopen(temporary, "wb");
+  if (file == NULL) {
+    perror("fopen");
+    return;
+  }
+  int length = metrics_format(sBuffer, METRICS_BUFFER_SIZE);
+  int written = (int)fwrite(sBuffer, 1, length, file);
+  if (fclose(file) != 0 || written != length) {
+    printf("Unable to write the stats file %s\n", temporary);
+    return;
+  }
+  if (rename(temporary, sFile) != 0) {
+    // renaming over an existing file is not supported on all platforms.
+    remove(sFile);
+    rename(temporary, sFile);
+  }
+}
+
+// ============================================================================
+// answer the request of the HTTP client with the metrics and close the connection.
+static void respond(TCPsocket client)
+{
+  // any request gets the metrics as the response.
+  char request[1024];
+  SDLNet_TCP_Recv(client, request, sizeof(request));
+
+  char header[256];
+  int length = metrics_format(sResponse, METRICS_BUFFER_SIZE);
+  int size = snprintf(header, sizeof(header),
+    "HTTP/1.0 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4\r\n"
+    "Content-Length: %d\r\n"
+    "Connection: close\r\n\r\n", length);
+  SDLNet_TCP_Send(client, header, size);
+  SDLNet_TCP_Send(client, sResponse, length);
+}
+
+// ============================================================================
+// accept new HTTP clients and answer the ones whose request has arrived.
+static void serve()
+{
+  if (SDLNet_CheckSockets(sSocketSet, METRICS_WAIT) <= 0) {
+    return;
+  }
+  for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+    if (sClients[i] != NULL && SDLNet_SocketReady(sClients[i])) {
+      respond(sClients[i]);
+      SDLNet_TCP_DelSocket(sSocketSet, sClients[i]);
+      SDLNet_TCP_Close(sClients[i]);
+      sClients[i] = NULL;
+    }
+  }
+  if (SDLNet_SocketReady(sListener)) {
+    TCPsocket client = SDLNet_TCP_Accept(sListener);
+    for (int i = 0; client != NULL && i < METRICS_MAX_CLIENTS; i++) {
+      if (sClients[i] == NULL) {
+        sClients[i] = client;
+        SDLNet_TCP_AddSocket(sSocketSet, client);
+        client = NULL;
+      }
+    }
+    // reject the client when all slots are busy.
+    if (client != NULL) {
+      SDLNet_TCP_Close(client);
+    }
+  }
+}
+
+// ============================================================================
+// answer the HTTP clients until stopped so a slow client never blocks the game loop.
+static int serve_run(void* data)
+{
+  (void)data;
+  while (SDL_AtomicGet(&sServing) == 1) {
+    serve();
+  }
+  for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+    if (sClients[i] != NULL) {
+      SDLNet_TCP_Close(sClients[i]);
+      sClients[i] = NULL;
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+
+void metrics_add(int id, int amount)
+{
+  SDL_assert(id >= 0 && id < METRIC_COUNT);
+  SDL_assert(METRICS[id].type == METRIC_COUNTER && METRICS[id].per_type == 0);
+  SDL_AtomicAdd(&sValues[id][0], amount);
+}
+
+// ============================================================================
+
+void metrics_add_message(int id, int type, int amount)
+{
+  SDL_assert(id >= 0 && id < METRIC_COUNT);
+  SDL_assert(METRICS[id].type == METRIC_COUNTER && METRICS[id].per_type == 1);
+  SDL_assert(type >= 0 && type < MESSAGE_TYPE_COUNT);
+  SDL_AtomicAdd(&sValues[id][type], amount);
+}
+
+// ============================================================================
+
+void metrics_count_sent(int type, int length)
+{
+  metrics_add_message(METRIC_MESSAGES_SENT, type, 1);
+  metrics_add_message(METRIC_BYTES_SENT, type, length);
+}
+
+// ============================================================================
+
+void metrics_count_received(int type, int length)
+{
+  metrics_add_message(METRIC_MESSAGES_RECEIVED, type, 1);
+  metrics_add_message(METRIC_BYTES_RECEIVED, type, length);
+}
+
+// ============================================================================
+
+void metrics_set(int id, int value)
+{
+  SDL_assert(id >= 0 && id < METRIC_COUNT);
+  SDL_assert(METRICS[id].type == METRIC_GAUGE);
+  SDL_AtomicSet(&sValues[id][0], value);
+}
+
+// ============================================================================
+
+void metrics_observe(int id, int value)
+{
+  SDL_assert(id >= 0 && id < METRIC_COUNT);
+  SDL_assert(METRICS[id].type == METRIC_HISTOGRAM);
+  Histogram* histogram = &sHistograms[id];
+  Uint32 sample = (Uint32)SDL_max(0, value);
+  SDL_AtomicAdd(&histogram->counts[bucket_index(sample)], 1);
+  SDL_AtomicAdd(&histogram->sum, (int)sample);
+}
+
+// ============================================================================
+
+Uint64 metrics_now()
+{
+  return SDL_GetPerformanceCounter();
+}
+
+// ============================================================================
+
+void metrics_observe_since(int id, Uint64 started)
+{
+  Uint64 elapsed = SDL_GetPerformanceCounter() - started;
+  metrics_observe(id, (int)SDL_min(elapsed * 1000000 / SDL_GetPerformanceFrequency(), SDL_MAX_SINT32));
+}
+
+// ============================================================================
+
+void metrics_set_file(const char* path)
+{
+  sFile = path;
+  sNextWrite = SDL_GetTicks();
+}
+
+// ============================================================================
+
+int metrics_serve(int port)
+{
+  SDL_assert(port >= 0 && port <= 65535);
+  if (port == 0) {
+    return 0;
+  }
+
+  // SDL_net binds the listening socket to all interfaces.
+  IPaddress ip;
+  if (SDLNet_ResolveHost(&ip, NULL, (Uint16)port) != 0) {
+    printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+    return -1;
+  }
+  sListener = SDLNet_TCP_Open(&ip);
+  if (sListener == NULL) {
+    printf("SDLNet_TCP_Open: %s\n", SDLNet_GetError());
+    return -1;
+  }
+  sSocketSet = SDLNet_AllocSocketSet(METRICS_MAX_CLIENTS + 1);
+  if (sSocketSet == NULL) {
+    printf("SDLNet_AllocSocketSet: %s\n", SDLNet_GetError());
+    SDLNet_TCP_Close(sListener);
+    sListener = NULL;
+    return -1;
+  }
+  SDLNet_TCP_AddSocket(sSocketSet, sListener);
+
+  // the HTTP thread and the stats file writer share the collected totals.
+  sLock = SDL_CreateMutex();
+  if (sLock == NULL) {
+    printf("SDL_CreateMutex: %s\n", SDL_GetError());
+    metrics_close();
+    return -1;
+  }
+  SDL_AtomicSet(&sServing, 1);
+  sThread = SDL_CreateThread(&serve_run, "metrics", NULL);
+  if (sThread == NULL) {
+    printf("SDL_CreateThread: %s\n", SDL_GetError());
+    metrics_close();
+    return -1;
+  }
+  return 0;
+}
+
+// ============================================================================
+
+void metrics_close()
+{
+  if (sThread != NULL) {
+    SDL_AtomicSet(&sServing, 0);
+    SDL_WaitThread(sThread, NULL);
+    sThread = NULL;
+  }
+  if (sSocketSet != NULL) {
+    SDLNet_FreeSocketSet(sSocketSet);
+    sSocketSet = NULL;
+  }
+  if (sListener != NULL) {
+    SDLNet_TCP_Close(sListener);
+    sListener = NULL;
+  }
+  if (sLock != NULL) {
+    SDL_DestroyMutex(sLock);
+    sLock = NULL;
+  }
+}
+
+// ============================================================================
+
+void metrics_poll()
+{
+  int ticks = SDL_GetTicks();
+  if (sFile != NULL && ticks >= sNextWrite) {
+    write_file();
+    sNextWrite = ticks + METRICS_INTERVAL;
+  }
+}
+
+// ============================================================================
+
+void metrics_flush()
+{
+  if (sFile != NULL) {
+    write_file();
+  }
+}
+
+// ============================================================================
+
+int metrics_format(char* buffer, int size)
+{
+  SDL_assert(buffer != NULL);
+  SDL_assert(size > 0);
+
+  if (sLock != NULL) {
+    SDL_LockMutex(sLock);
+  }
+  collect();
+  int length = 0;
+  for (int id = 0; id < METRIC_COUNT; id++) {
+    const MetricInfo* info = &METRICS[id];
+    const char* type = (info->type == METRIC_COUNTER ? "counter"
+      : info->type == METRIC_GAUGE ? "gauge" : "histogram");
+    length = append(buffer, size, length, "# HELP %s %s\n# TYPE %s %s\n",
+      info->name, info->help, info->name, type);
+
+    if (info->type == METRIC_HISTOGRAM) {
+      // the buckets are cumulative with the inclusive upper bound of each bucket.
+      const Histogram* histogram = &sHistograms[id];
+      Uint64 count = 0;
+      for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+        count += histogram->totals[i];
+        length = append(buffer, size, length, "%s_bucket{le=\"%u\"} %llu\n",
+          info->name, (unsigned)bucket_bound(i), (unsigned long long)count);
+      }
+      count += histogram->totals[METRICS_HISTOGRAM_BUCKETS - 1];
+      length = append(buffer, size, length, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %llu\n%s_count %llu\n",
+        info->name, (unsigned long long)count, info->name, (unsigned long long)histogram->total_sum,
+        info->name, (unsigned long long)count);
+    } else if (info->type == METRIC_GAUGE) {
+      length = append(buffer, size, length, "%s %d\n", info->name, SDL_AtomicGet(&sValues[id][0]));
+    } else if (info->per_type == 1) {
+      for (int i = 0; i < MESSAGE_TYPE_COUNT; i++) {
+        length = append(buffer, size, length, "%s{type=\"%s\"} %llu\n",
+          info->name, protocol_get_name(i), (unsigned long long)sTotals[id][i]);
+      }
+    } else {
+      length = append(buffer, size, length, "%s %llu\n", info->name, (unsigned long long)sTotals[id][0]);
+    }
+  }
+  if (sLock != NULL) {
+    SDL_UnlockMutex(sLock);
+  }
+  return length;
+}
@@ -0,0 +1,103 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <SDL/SDL.h>
+
+// the amount of bits used for the linear sub-buckets within each power of two.
+#define METRICS_SUB_BITS 2
+// the amount of linear sub-buckets within each power of two of a histogram.
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BITS)
+// the amount of buckets of a histogram (the last one collects the overflow).
+#define METRICS_HISTOGRAM_BUCKETS 100
+// the interval (ms) between the rewrites of the stats file.
+#define METRICS_INTERVAL 1000
+// the maximum amount of concurrently served HTTP clients.
+#define METRICS_MAX_CLIENTS 4
+// the maximum time (ms) the HTTP thread waits for its sockets before checking whether to stop.
+#define METRICS_WAIT 100
+// the size of the buffer used to format the metrics.
+#define METRICS_BUFFER_SIZE 65536
+
+enum MetricType { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM };
+
+enum MetricId {
+  // the interval (us) between two rendered frames.
+  METRIC_FRAME_INTERVAL,
+  // the duration (us) of a single fixed timestep update.
+  METRIC_UPDATE_TIME,
+  // the duration (us) of rendering a frame.
+  METRIC_RENDER_TIME,
+  // the duration (us) of a multi-match server worker tick.
+  METRIC_TICK_TIME,
+  // the amount of server worker ticks which missed their deadline.
+  METRIC_TICK_OVERRUNS,
+  // the amount of matches hosted by the multi-match server.
+  METRIC_MATCHES,
+  // the round-trip time (ms) of each ping.
+  METRIC_RTT,
+  // the offset (ms) applied to the local clock.
+  METRIC_CLOCK_OFFSET,
+  // the estimated drift (ppm) of the remote clock.
+  METRIC_CLOCK_SKEW,
+  // the largest axis distance (px) of each ball correction received from the server.
+  METRIC_BALL_CORRECTION,
+  // the amount of frames simulated again by each rollback after a late remote input.
+  METRIC_ROLLBACK_FRAMES,
+  // the amount of client-side predictions changed by an authoritative state.
+  METRIC_PREDICTION_CORRECTIONS,
+  // the amount of keyframe requests after a missing or malformed delta snapshot.
+  METRIC_KEYFRAME_REQUESTS,
+  // the amount of sent UDP packets.
+  METRIC_PACKETS_SENT,
+  // the amount of received UDP packets.
+  METRIC_PACKETS_RECEIVED,
+  // the amount of duplicated, too old and malformed UDP packets.
+  METRIC_PACKETS_DROPPED,
+  // the amount of UDP packets received after a newer packet.
+  METRIC_PACKETS_LATE,
+  // the amount of reliable message retransmissions.
+  METRIC_RETRANSMISSIONS,
+  // the amount of sent messages of each type (including retransmissions).
+  METRIC_MESSAGES_SENT,
+  // the amount of accepted received messages of each type (without duplicates).
+  METRIC_MESSAGES_RECEIVED,
+  // the amount of sent bytes of each message type.
+  METRIC_BYTES_SENT,
+  // the amount of accepted received bytes of each message type.
+  METRIC_BYTES_RECEIVED,
+  METRIC_COUNT
+};
+
+// ============================================================================
+
+// add the amount to the counter.
+void metrics_add(int id, int amount);
+// add the amount to the series of the message type of the per type counter.
+void metrics_add_message(int id, int type, int amount);
+// count a sent message of the given type with its encoded length.
+void metrics_count_sent(int type, int length);
+// count an accepted received message of the given type with its encoded length.
+void metrics_count_received(int type, int length);
+// set the value of the gauge.
+void metrics_set(int id, int value);
+// record the value into the histogram.
+void metrics_observe(int id, int value);
+// get a timestamp to measure a duration with metrics_observe_since.
+Uint64 metrics_now();
+// record the microseconds elapsed since the timestamp into the histogram.
+void metrics_observe_since(int id, Uint64 started);
+
+// select the file where the metrics are periodically written (NULL to disable).
+void metrics_set_file(const char* path);
+// serve the metrics over HTTP from a separate thread on the given port (zero to disable). returns -1 on failure.
+int metrics_serve(int port);
+// stop serving the metrics over HTTP and close its sockets.
+void metrics_close();
+// write the stats file when due (call from one thread).
+void metrics_poll();
+// write the stats file immediately (e.g. when the application exits).
+void metrics_flush();
+// format all metrics in the Prometheus text format. returns the length of the text.
+int metrics_format(char* buffer, int size);
+
+#endif
@@ -0,0 +1,255 @@
+#include "netsim.h"
+#include "metrics.h"
+
+#include <stdio.h>
+
+// the impairment model used by the simulated links.
+static NetSimConfig sConfig = { 0, 0, 0, 0, 0, 1 };
+
+// ============================================================================
+// get the next value of the random generator of the link (xorshift).
+static Uint32 next_random(NetSimLink* link)
+{
+  Uint32 value = link->random;
+  value ^= value << 13;
+  value ^= value >> 17;
+  value ^= value << 5;
+  link->random = value;
+  return value;
+}
+
+// ============================================================================
+// check whether an event with the given percentage chance happens.
+static int chance(NetSimLink* link, int percentage)
+{
+  return percentage > 0 && (int)(next_random(link) % 100) < percentage;
+}
+
+// ============================================================================
+// get a triangularly distributed delay around the base delay within the jitter.
+static int sample_delay(NetSimLink* link)
+{
+  int delay = sConfig.delay;
+  if (sConfig.jitter > 0) {
+    int range = sConfig.jitter + 1;
+    delay += (int)(next_random(link) % range) - (int)(next_random(link) % range);
+  }
+  return SDL_max(0, delay);
+}
+
+// ============================================================================
+// put a copy of the packet in flight to be delivered at the given time.
+static void enqueue(NetSimLink* link, const Uint8* data, int size, int time)
+{
+  if (link->count == NETSIM_QUEUE_SIZE) {
+    link->lost++;
+    return;
+  }
+  NetSimPacket* packet = &link->packets[link->count++];
+  SDL_memcpy(packet->data, data, size);
+  packet->size = size;
+  packet->time = time;
+  packet->order = link->order++;
+}
+
+// ============================================================================
+// get the delivery time of a packet sent at the given time.
+static int delivery_time(NetSimLink* link, int now)
+{
+  // jitter alone keeps the packets in order like a queue in a real router.
+  int time = now + sample_delay(link);
+  if (chance(link, sConfig.reorder)) {
+    link->reordered++;
+    return time + NETSIM_REORDER_HOLD;
+  }
+  link->ordered_time = SDL_max(link->ordered_time, time);
+  return link->ordered_time;
+}
+
+// ============================================================================
+
+void netsim_set_config(const NetSimConfig* config)
+{
+  SDL_assert(config != NULL);
+  SDL_assert(config->loss >= 0 && config->loss <= 100);
+  SDL_assert(config->duplicate >= 0 && config->duplicate <= 100);
+  SDL_assert(config->reorder >= 0 && config->reorder <= 100);
+  sConfig = *config;
+}
+
+// ============================================================================
+
+const NetSimConfig* netsim_get_config()
+{
+  return &sConfig;
+}
+
+// ============================================================================
+
+void netsim_link_init(NetSimLink* link, Uint32 salt)
+{
+  SDL_assert(link != NULL);
+
+  SDL_memset(link, 0, sizeof(NetSimLink));
+  link->ordered_time = 0;
+  link->random = (sConfig.seed * 2654435761u) ^ (salt * 40503u);
+  link->random = (link->random == 0 ? 1 : link->random);
+}
+
+// ============================================================================
+
+void netsim_link_send(NetSimLink* link, const Uint8* data, int size, int now)
+{
+  SDL_assert(link != NULL);
+  SDL_assert(data != NULL);
+  SDL_assert(size > 0 && size <= NETWORK_MTU);
+
+  link->sent++;
+  if (chance(link, sConfig.loss)) {
+    link->lost++;
+    return;
+  }
+  enqueue(link, data, size, delivery_time(link, now));
+  if (chance(link, sConfig.duplicate)) {
+    link->duplicated++;
+    enqueue(link, data, size, delivery_time(link, now));
+  }
+}
+
+// ============================================================================
+
+int netsim_link_receive(NetSimLink* link, Uint8* buffer, int now)
+{
+  SDL_assert(link != NULL);
+  SDL_assert(buffer != NULL);
+
+  // find the earliest delivered packet, where equal times keep the send order.
+  int next = -1;
+  for (int i = 0; i < link->count; i++) {
+    const NetSimPacket* packet = &link->packets[i];
+    if (packet->time <= now && (next < 0
+      || packet->time < link->packets[next].time
+      || (packet->time == link->packets[next].time && packet->order < link->packets[next].order))) {
+      next = i;
+    }
+  }
+  if (next < 0) {
+    return 0;
+  }
+
+  // move the last packet into the place of the removed one.
+  int size = link->packets[next].size;
+  SDL_memcpy(buffer, link->packets[next].data, size);
+  link->packets[next] = link->packets[--link->count];
+  return size;
+}
+
+// ============================================================================
+
+int netsim_link_wait(const NetSimLink* link, int now)
+{
+  SDL_assert(link != NULL);
+
+  int wait = -1;
+  for (int i = 0; i < link->count; i++) {
+    int remaining = SDL_max(0, link->packets[i].time - now);
+    wait = (wait < 0 ? remaining : SDL_min(wait, remaining));
+  }
+  return wait;
+}
+
+// ============================================================================
+
+void netsim_node_init(NetSimNode* node, Match* match, NetSimLink* output, NetSimLink* input)
+{
+  SDL_assert(node != NULL);
+  SDL_assert(match != NULL);
+  SDL_assert(output != NULL);
+  SDL_assert(input != NULL);
+
+  node->match = match;
+  node->output = output;
+  node->input = input;
+  node->batch_size = 0;
+  channel_init(&node->channel);
+}
+
+// ============================================================================
+
+void netsim_send(Match* match, const Message* msg)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(msg != NULL);
+  NetSimNode* node = (NetSimNode*)match->connection;
+  SDL_assert(node != NULL);
+
+  // control messages are queued into the reliable channel.
+  if (channel_is_reliable(msg->type) == 1) {
+    if (channel_queue(&node->channel, msg) < 0) {
+      printf("Remote node does not acknowledge messages: Closing application...\n");
+      match->state = STOPPED;
+    }
+    return;
+  }
+
+  // encode the message into the batch and split the batch at the MTU.
+  int limit = NETWORK_MTU - CHANNEL_RESERVED_SIZE;
+  int size = protocol_encode(msg, node->batch + node->batch_size, limit - node->batch_size);
+  if (size == 0) {
+    netsim_node_flush(node, match_get_time_source()());
+    size = protocol_encode(msg, node->batch, limit);
+  }
+  SDL_assert(size > 0);
+  metrics_count_sent(msg->type, size);
+  node->batch_size += size;
+}
+
+// ============================================================================
+
+void netsim_node_flush(NetSimNode* node, int now)
+{
+  SDL_assert(node != NULL);
+  if (node->batch_size == 0 && channel_has_output(&node->channel, now) == 0) {
+    return;
+  }
+
+  // prefix the unreliable batch with the channel header and the reliable messages.
+  Uint8 packet[NETWORK_MTU];
+  int length = channel_write(&node->channel, packet, NETWORK_MTU - node->batch_size, now);
+  SDL_memcpy(packet + length, node->batch, node->batch_size);
+  netsim_link_send(node->output, packet, length + node->batch_size, now);
+  node->batch_size = 0;
+}
+
+// ============================================================================
+
+void netsim_node_receive(NetSimNode* node, int now)
+{
+  SDL_assert(node != NULL);
+
+  Uint8 packet[NETWORK_MTU];
+  int size = 0;
+  while (node->match->state == RUNNING && (size = netsim_link_receive(node->input, packet, now)) > 0) {
+    // skip duplicated, too old and malformed packets.
+    int offset = channel_read(&node->channel, packet, size, now);
+    if (offset < 0) {
+      continue;
+    }
+
+    // dispatch the reliable messages in order before the unreliable ones.
+    Message msg;
+    while (channel_next(&node->channel, &msg) == 1) {
+      match_dispatch(node->match, &msg);
+    }
+    while (offset < size) {
+      int length = protocol_decode(packet + offset, size - offset, &msg);
+      if (length <= 0) {
+        printf("Received a malformed simulated packet: Ignoring it...\n");
+        break;
+      }
+      offset += length;
+      metrics_count_received(msg.type, length);
+      match_dispatch(node->match, &msg);
+    }
+  }
+}
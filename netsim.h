@@ -0,0 +1,102 @@
+#ifndef NETSIM_H
+#define NETSIM_H
+
+#include <SDL/SDL.h>
+
+#include "channel.h"
+#include "game.h"
+
+// the maximum amount of packets in flight on a single simulated link.
+#define NETSIM_QUEUE_SIZE 256
+// the extra time (ms) a reordered packet is held back on top of its delay.
+#define NETSIM_REORDER_HOLD (2 * TIMESTEP)
+
+typedef struct {
+  // the base one-way delay (ms) of each packet.
+  int delay;
+  // the maximum deviation (ms) from the base delay.
+  int jitter;
+  // the percentage of lost packets.
+  int loss;
+  // the percentage of duplicated packets.
+  int duplicate;
+  // the percentage of packets held back to be overtaken by later ones.
+  int reorder;
+  // the seed of the deterministic impairment decisions.
+  Uint32 seed;
+} NetSimConfig;
+
+typedef struct {
+  // the packet contents.
+  Uint8 data[NETWORK_MTU];
+  // the size of the packet in bytes.
+  int size;
+  // the time when the packet is delivered.
+  int time;
+  // the order in which the packet was queued.
+  Uint32 order;
+} NetSimPacket;
+
+typedef struct {
+  // the packets in flight (in no particular order).
+  NetSimPacket packets[NETSIM_QUEUE_SIZE];
+  // the amount of packets in flight.
+  int count;
+  // the order of the next queued packet.
+  Uint32 order;
+  // the delivery time of the most recent packet kept in order.
+  int ordered_time;
+  // the state of the random generator of the link.
+  Uint32 random;
+  // the amount of packets sent into the link.
+  int sent;
+  // the amount of lost (or overflown) packets.
+  int lost;
+  // the amount of duplicated packets.
+  int duplicated;
+  // the amount of reordered packets.
+  int reordered;
+} NetSimLink;
+
+typedef struct {
+  // the match played by the node.
+  Match* match;
+  // the link used to send packets to the remote node.
+  NetSimLink* output;
+  // the link used to receive packets from the remote node.
+  NetSimLink* input;
+  // the reliable channel used to deliver the control messages.
+  Channel channel;
+  // the batch buffer for the unreliable outgoing messages.
+  Uint8 batch[NETWORK_MTU];
+  // the amount of batched bytes in the batch buffer.
+  int batch_size;
+} NetSimNode;
+
+// ============================================================================
+
+// select the impairment model used by the simulated links.
+void netsim_set_config(const NetSimConfig* config);
+// get the impairment model used by the simulated links.
+const NetSimConfig* netsim_get_config();
+
+// initialize the link to be empty with a random generator derived from the seed.
+void netsim_link_init(NetSimLink* link, Uint32 salt);
+// send the packet into the link with the configured impairments.
+void netsim_link_send(NetSimLink* link, const Uint8* data, int size, int now);
+// receive the next delivered packet into the buffer (of at least NETWORK_MTU bytes).
+// returns the size of the packet or zero when no packet has been delivered yet.
+int netsim_link_receive(NetSimLink* link, Uint8* buffer, int now);
+// get the time (ms) until the next packet is delivered or -1 when none is in flight.
+int netsim_link_wait(const NetSimLink* link, int now);
+
+// initialize the node to play the match over the given links.
+void netsim_node_init(NetSimNode* node, Match* match, NetSimLink* output, NetSimLink* input);
+// batch the message to be sent to the remote node (net_send_func for matches of nodes).
+void netsim_send(Match* match, const Message* msg);
+// send the batched messages and the due reliable messages as a single packet.
+void netsim_node_flush(NetSimNode* node, int now);
+// receive and dispatch all delivered messages to the match of the node.
+void netsim_node_receive(NetSimNode* node, int now);
+
+#endif
@@ -0,0 +1,159 @@
+#include "predict.h"
+#include "game.h"
+#include "metrics.h"
+
+// the amount of bits used to pack a single input into an input message.
+#define INPUT_BITS 2
+// the correction distance after which objects snap instead of being smoothed.
+#define SNAP_DISTANCE (PADDLE_HEIGHT * 2)
+// the portion (in quarters) of the visual error kept on each frame.
+#define SMOOTHING_QUARTERS 3
+
+// ============================================================================
+// simulate a single step with the client input stored for the sequence.
+static void replay(Prediction* prediction, int sequence)
+{
+  SimInput input = { prediction->remote_input, prediction->inputs[sequence % PREDICT_INPUT_BUFFER] };
+  sim_step(&prediction->state, &input, &prediction->state);
+}
+
+// ============================================================================
+// add the correction into the visual offset or snap when it is too large.
+static int correct(Fixed* offset, Fixed error)
+{
+  if (error < -sim_fixed(SNAP_DISTANCE) || error > sim_fixed(SNAP_DISTANCE)) {
+    *offset = 0;
+    return 1;
+  }
+  *offset += error;
+  return 0;
+}
+
+// ============================================================================
+
+void prediction_init(Prediction* prediction, Uint32 seed)
+{
+  SDL_assert(prediction != NULL);
+
+  SDL_memset(prediction, 0, sizeof(Prediction));
+  prediction->enabled = 1;
+  prediction->acked = -1;
+  prediction->received = -1;
+  prediction->remote_input = NONE;
+  for (int i = 0; i < PREDICT_INPUT_BUFFER; i++) {
+    prediction->input_sequences[i] = -1;
+  }
+  sim_init(&prediction->state, seed);
+}
+
+// ============================================================================
+
+void prediction_receive(Prediction* prediction, int sequence, int inputs)
+{
+  SDL_assert(prediction != NULL);
+
+  // store the unprocessed inputs which fit into the queue.
+  for (int i = PREDICT_INPUT_HISTORY - 1; i >= 0; i--) {
+    int s = sequence - i;
+    if (s > prediction->acked && s <= prediction->acked + PREDICT_INPUT_BUFFER) {
+      int index = s % PREDICT_INPUT_BUFFER;
+      prediction->input_sequences[index] = s;
+      prediction->inputs[index] = (Sint8)sim_unpack_input((inputs >> (i * INPUT_BITS)) & 3);
+    }
+  }
+  prediction->received = SDL_max(prediction->received, sequence);
+}
+
+// ============================================================================
+
+int prediction_server_step(Prediction* prediction, int input)
+{
+  SDL_assert(prediction != NULL);
+
+  // apply the client inputs in order and skip the ones lost for good.
+  int next = prediction->acked + 1;
+  int index = next % PREDICT_INPUT_BUFFER;
+  int remote = NONE;
+  if (prediction->input_sequences[index] == next) {
+    remote = prediction->inputs[index];
+    prediction->remote_input = remote;
+    prediction->acked = next;
+  } else if (prediction->received >= next + PREDICT_INPUT_HISTORY) {
+    remote = prediction->remote_input;
+    prediction->acked = next;
+  }
+
+  SimInput step = { input, remote };
+  return sim_step(&prediction->state, &step, &prediction->state);
+}
+
+// ============================================================================
+
+int prediction_client_step(Prediction* prediction, int input)
+{
+  SDL_assert(prediction != NULL);
+
+  // store the input for the replays and predict its outcome.
+  int sequence = prediction->sequence++;
+  int index = sequence % PREDICT_INPUT_BUFFER;
+  prediction->inputs[index] = (Sint8)input;
+  prediction->input_sequences[index] = sequence;
+  replay(prediction, sequence);
+
+  // smooth out the visual errors of the previous corrections.
+  prediction->left_offset = prediction->left_offset * SMOOTHING_QUARTERS / 4;
+  prediction->right_offset = prediction->right_offset * SMOOTHING_QUARTERS / 4;
+  prediction->ball_offset_x = prediction->ball_offset_x * SMOOTHING_QUARTERS / 4;
+  prediction->ball_offset_y = prediction->ball_offset_y * SMOOTHING_QUARTERS / 4;
+  return sequence;
+}
+
+// ============================================================================
+
+int prediction_client_inputs(const Prediction* prediction, int sequence)
+{
+  SDL_assert(prediction != NULL);
+  SDL_assert(sequence < prediction->sequence);
+
+  int inputs = 0;
+  for (int i = 0; i < PREDICT_INPUT_HISTORY && sequence - i >= 0; i++) {
+    int input = prediction->inputs[(sequence - i) % PREDICT_INPUT_BUFFER];
+    inputs |= sim_pack_input(input) << (i * INPUT_BITS);
+  }
+  return inputs;
+}
+
+// ============================================================================
+
+void prediction_reconcile(Prediction* prediction, const SimState* state, int ack, int remote_input)
+{
+  SDL_assert(prediction != NULL);
+  SDL_assert(state != NULL);
+
+  // skip authoritative states which are older than the already applied one.
+  if (state->tick <= prediction->snapshot_tick) {
+    return;
+  }
+  prediction->snapshot_tick = state->tick;
+  prediction->acked = SDL_max(prediction->acked, ack);
+  prediction->remote_input = remote_input;
+
+  // rebase on the authoritative state and replay the unacknowledged inputs.
+  SimState predicted = prediction->state;
+  prediction->state = *state;
+  int first = SDL_max(prediction->acked + 1, prediction->sequence - PREDICT_INPUT_BUFFER);
+  for (int sequence = first; sequence < prediction->sequence; sequence++) {
+    replay(prediction, sequence);
+  }
+
+  // hide the correction behind a visual offset which is smoothed away.
+  if (SDL_memcmp(&predicted, &prediction->state, sizeof(SimState)) != 0) {
+    prediction->corrections++;
+    metrics_add(METRIC_PREDICTION_CORRECTIONS, 1);
+    int snapped = correct(&prediction->left_offset, predicted.left_y - prediction->state.left_y);
+    snapped |= correct(&prediction->right_offset, predicted.right_y - prediction->state.right_y);
+    snapped |= correct(&prediction->ball_offset_x, predicted.ball_x - prediction->state.ball_x);
+    snapped |= correct(&prediction->ball_offset_y, predicted.ball_y - prediction->state.ball_y);
+    prediction->snaps += snapped;
+  }
+}
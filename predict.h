@@ -0,0 +1,62 @@
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include "sim.h"
+
+// the amount of client inputs buffered for the replay and the server queue.
+#define PREDICT_INPUT_BUFFER 64
+// the amount of inputs included into a single client input message.
+#define PREDICT_INPUT_HISTORY 8
+
+typedef struct {
+  // a definition whether the prediction mode is in use.
+  int enabled;
+  // the sequence number of the next local client input.
+  int sequence;
+  // the newest input sequence acknowledged (client) or processed (server).
+  int acked;
+  // the newest received client input sequence (server).
+  int received;
+  // the buffered inputs of the client indexed by their sequence number.
+  Sint8 inputs[PREDICT_INPUT_BUFFER];
+  // the sequence number of each buffered input (-1 for none).
+  int input_sequences[PREDICT_INPUT_BUFFER];
+  // the simulation tick of the newest applied authoritative state (client).
+  Uint32 snapshot_tick;
+  // the most recent known input of the remote paddle.
+  int remote_input;
+  // the authoritative (server) or predicted (client) simulation state.
+  SimState state;
+  // the visual offset of the left paddle smoothed away after corrections.
+  Fixed left_offset;
+  // the visual offset of the right paddle smoothed away after corrections.
+  Fixed right_offset;
+  // the visual offset of the ball in x-axis smoothed away after corrections.
+  Fixed ball_offset_x;
+  // the visual offset of the ball in y-axis smoothed away after corrections.
+  Fixed ball_offset_y;
+  // the amount of reconciliations which changed the predicted state.
+  int corrections;
+  // the amount of corrections too large to be smoothed.
+  int snaps;
+} Prediction;
+
+// ============================================================================
+
+// initialize the prediction with the given simulation seed.
+void prediction_init(Prediction* prediction, Uint32 seed);
+
+// store the received client inputs ending at the given sequence (server).
+void prediction_receive(Prediction* prediction, int sequence, int inputs);
+// simulate a single authoritative step with the next queued client input (server).
+// returns the SimEvent flags of the step.
+int prediction_server_step(Prediction* prediction, int input);
+
+// simulate a single predicted step with the local input and return its sequence (client).
+int prediction_client_step(Prediction* prediction, int input);
+// get the packed local inputs of the given sequence and the preceding ones (client).
+int prediction_client_inputs(const Prediction* prediction, int sequence);
+// rebase the prediction on an authoritative state and replay unacknowledged inputs (client).
+void prediction_reconcile(Prediction* prediction, const SimState* state, int ack, int remote_input);
+
+#endif
@@ -0,0 +1,580 @@
+#include "protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the size of the binary message header (version and opcode).
+#define BINARY_HEADER_SIZE 2
+// the maximum amount of numeric fields in a single message.
+#define MAX_FIELDS 6
+
+// the total size of each binary message including the header (without variable data).
+static const int BINARY_SIZES[MESSAGE_TYPE_COUNT] = {
+  [MESSAGE_HELLO] = BINARY_HEADER_SIZE,
+  [MESSAGE_QUIT] = BINARY_HEADER_SIZE,
+  [MESSAGE_PING] = BINARY_HEADER_SIZE + 4,
+  [MESSAGE_PONG] = BINARY_HEADER_SIZE + 4 + 4,
+  [MESSAGE_LEFT] = BINARY_HEADER_SIZE + 4 + 2 + 2,
+  [MESSAGE_RIGHT] = BINARY_HEADER_SIZE + 4 + 2 + 2,
+  [MESSAGE_BALL] = BINARY_HEADER_SIZE + 4 + 2 + 2 + 1 + 1 + 2,
+  [MESSAGE_RESET] = BINARY_HEADER_SIZE + 4 + 4 + 1 + 1 + 1 + 1,
+  [MESSAGE_GOAL] = BINARY_HEADER_SIZE,
+  [MESSAGE_END] = BINARY_HEADER_SIZE,
+  [MESSAGE_END_OK] = BINARY_HEADER_SIZE,
+  [MESSAGE_START] = BINARY_HEADER_SIZE + 4 + 4,
+  [MESSAGE_INPUT] = BINARY_HEADER_SIZE + 4 + 2 + 4,
+  [MESSAGE_SNAPSHOT] = BINARY_HEADER_SIZE + 4 + 1 + 4 + 1 + 1
+};
+
+// the name of each message in the text format.
+static const char* TEXT_NAMES[MESSAGE_TYPE_COUNT] = {
+  [MESSAGE_HELLO] = "hello",
+  [MESSAGE_QUIT] = "quit",
+  [MESSAGE_PING] = "ping",
+  [MESSAGE_PONG] = "pong",
+  [MESSAGE_LEFT] = "left",
+  [MESSAGE_RIGHT] = "right",
+  [MESSAGE_BALL] = "ball",
+  [MESSAGE_RESET] = "reset",
+  [MESSAGE_GOAL] = "goal",
+  [MESSAGE_END] = "end",
+  [MESSAGE_END_OK] = "end-ok",
+  [MESSAGE_START] = "start",
+  [MESSAGE_INPUT] = "input",
+  [MESSAGE_SNAPSHOT] = "snapshot"
+};
+
+// the amount of numeric fields in each message in the text format.
+static const int TEXT_FIELDS[MESSAGE_TYPE_COUNT] = {
+  [MESSAGE_PING] = 1,
+  [MESSAGE_PONG] = 2,
+  [MESSAGE_LEFT] = 3,
+  [MESSAGE_RIGHT] = 3,
+  [MESSAGE_BALL] = 6,
+  [MESSAGE_RESET] = 6,
+  [MESSAGE_START] = 2,
+  [MESSAGE_INPUT] = 3,
+  [MESSAGE_SNAPSHOT] = 5
+};
+
+// the wire format used to encode and decode messages.
+static int sFormat = BINARY;
+
+// ============================================================================
+// write a 8-bit value into the buffer and return a pointer after the value.
+static Uint8* write8(Uint8* buffer, int value)
+{
+  buffer[0] = (Uint8)value;
+  return buffer + 1;
+}
+
+// ============================================================================
+// write a 16-bit little-endian value into the buffer.
+static Uint8* write16(Uint8* buffer, int value)
+{
+  protocol_write16(buffer, (Uint16)value);
+  return buffer + 2;
+}
+
+// ============================================================================
+// write a 32-bit little-endian value into the buffer.
+static Uint8* write32(Uint8* buffer, int value)
+{
+  protocol_write32(buffer, (Uint32)value);
+  return buffer + 4;
+}
+
+// ============================================================================
+// read a signed 8-bit value from the data.
+static int read8(const Uint8** data)
+{
+  Sint8 value = (Sint8)(*data)[0];
+  *data += 1;
+  return value;
+}
+
+// ============================================================================
+// read a signed 16-bit little-endian value from the data.
+static int read16(const Uint8** data)
+{
+  Sint16 value = (Sint16)protocol_read16(*data);
+  *data += 2;
+  return value;
+}
+
+// ============================================================================
+// read a signed 32-bit little-endian value from the data.
+static int read32(const Uint8** data)
+{
+  Sint32 value = (Sint32)protocol_read32(*data);
+  *data += 4;
+  return value;
+}
+
+// ============================================================================
+// append the data as hexadecimal digits and a separator into the text buffer.
+static int encode_hex(const Uint8* data, int count, char* out, int size, int length)
+{
+  static const char DIGITS[] = "0123456789abcdef";
+  if (length < 0 || length + count * 2 + 1 >= size) {
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    out[length++] = DIGITS[data[i] >> 4];
+    out[length++] = DIGITS[data[i] & 0xf];
+  }
+  out[length++] = PROTOCOL_TEXT_SEPARATOR;
+  out[length] = '\0';
+  return length;
+}
+
+// ============================================================================
+// get the value of a single hexadecimal digit or -1 for an invalid digit.
+static int hex_value(char digit)
+{
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  } else if (digit >= 'a' && digit <= 'f') {
+    return digit - 'a' + 10;
+  }
+  return -1;
+}
+
+// ============================================================================
+// read the given amount of bytes from the hexadecimal text.
+static int decode_hex(const char* text, Uint8* data, int count)
+{
+  if (count == 0) {
+    return 0;
+  } else if (text == NULL || (int)strlen(text) != count * 2) {
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    int high = hex_value(text[i * 2]);
+    int low = hex_value(text[i * 2 + 1]);
+    if (high < 0 || low < 0) {
+      return -1;
+    }
+    data[i] = (Uint8)((high << 4) | low);
+  }
+  return 0;
+}
+
+// ============================================================================
+// encode the message with the binary format.
+static int encode_binary(const Message* msg, Uint8* buffer, int size)
+{
+  int length = BINARY_SIZES[msg->type];
+  if (msg->type == MESSAGE_SNAPSHOT) {
+    SDL_assert(msg->snapshot.length >= 0 && msg->snapshot.length <= PROTOCOL_MAX_SNAPSHOT_DATA);
+    length += msg->snapshot.length;
+  }
+  if (length > size) {
+    return 0;
+  }
+
+  Uint8* out = write8(buffer, PROTOCOL_VERSION);
+  out = write8(out, msg->type);
+  switch (msg->type) {
+    case MESSAGE_PING:
+      out = write32(out, msg->ping.time);
+      break;
+    case MESSAGE_PONG:
+      out = write32(out, msg->pong.ping);
+      out = write32(out, msg->pong.pong);
+      break;
+    case MESSAGE_LEFT:
+    case MESSAGE_RIGHT:
+      out = write32(out, msg->paddle.time);
+      out = write16(out, msg->paddle.x);
+      out = write16(out, msg->paddle.y);
+      break;
+    case MESSAGE_BALL:
+      out = write32(out, msg->ball.time);
+      out = write16(out, msg->ball.x);
+      out = write16(out, msg->ball.y);
+      out = write8(out, msg->ball.direction_x);
+      out = write8(out, msg->ball.direction_y);
+      out = write16(out, msg->ball.velocity);
+      break;
+    case MESSAGE_RESET:
+      out = write32(out, msg->reset.time);
+      out = write32(out, msg->reset.countdown);
+      out = write8(out, msg->reset.direction_x);
+      out = write8(out, msg->reset.direction_y);
+      out = write8(out, msg->reset.left_points);
+      out = write8(out, msg->reset.right_points);
+      break;
+    case MESSAGE_START:
+      out = write32(out, msg->start.time);
+      out = write32(out, msg->start.seed);
+      break;
+    case MESSAGE_INPUT:
+      out = write32(out, msg->input.frame);
+      out = write16(out, msg->input.inputs);
+      out = write32(out, msg->input.ack);
+      break;
+    case MESSAGE_SNAPSHOT:
+      out = write32(out, msg->snapshot.ack);
+      out = write8(out, msg->snapshot.input);
+      out = write32(out, msg->snapshot.tick);
+      out = write8(out, msg->snapshot.base);
+      out = write8(out, msg->snapshot.length);
+      memcpy(out, msg->snapshot.data, msg->snapshot.length);
+      out += msg->snapshot.length;
+      break;
+  }
+  SDL_assert(out - buffer == length);
+  return length;
+}
+
+// ============================================================================
+// decode a message with the binary format.
+static int decode_binary(const Uint8* data, int size, Message* msg)
+{
+  if (size < BINARY_HEADER_SIZE) {
+    return 0;
+  }
+
+  // verify the protocol version and the opcode of the message.
+  if (data[0] != PROTOCOL_VERSION || data[1] >= MESSAGE_TYPE_COUNT) {
+    return -1;
+  }
+  int length = BINARY_SIZES[data[1]];
+  if (size < length) {
+    return 0;
+  }
+
+  // include the variable length data which follows the fixed fields.
+  if (data[1] == MESSAGE_SNAPSHOT) {
+    int extra = data[length - 1];
+    if (extra > PROTOCOL_MAX_SNAPSHOT_DATA) {
+      return -1;
+    }
+    length += extra;
+    if (size < length) {
+      return 0;
+    }
+  }
+
+  const Uint8* in = data + BINARY_HEADER_SIZE;
+  msg->type = data[1];
+  switch (msg->type) {
+    case MESSAGE_PING:
+      msg->ping.time = read32(&in);
+      break;
+    case MESSAGE_PONG:
+      msg->pong.ping = read32(&in);
+      msg->pong.pong = read32(&in);
+      break;
+    case MESSAGE_LEFT:
+    case MESSAGE_RIGHT:
+      msg->paddle.time = read32(&in);
+      msg->paddle.x = read16(&in);
+      msg->paddle.y = read16(&in);
+      break;
+    case MESSAGE_BALL:
+      msg->ball.time = read32(&in);
+      msg->ball.x = read16(&in);
+      msg->ball.y = read16(&in);
+      msg->ball.direction_x = read8(&in);
+      msg->ball.direction_y = read8(&in);
+      msg->ball.velocity = read16(&in);
+      break;
+    case MESSAGE_RESET:
+      msg->reset.time = read32(&in);
+      msg->reset.countdown = read32(&in);
+      msg->reset.direction_x = read8(&in);
+      msg->reset.direction_y = read8(&in);
+      msg->reset.left_points = read8(&in);
+      msg->reset.right_points = read8(&in);
+      break;
+    case MESSAGE_START:
+      msg->start.time = read32(&in);
+      msg->start.seed = read32(&in);
+      break;
+    case MESSAGE_INPUT:
+      msg->input.frame = read32(&in);
+      msg->input.inputs = (Uint16)read16(&in);
+      msg->input.ack = read32(&in);
+      break;
+    case MESSAGE_SNAPSHOT:
+      msg->snapshot.ack = read32(&in);
+      msg->snapshot.input = read8(&in);
+      msg->snapshot.tick = read32(&in);
+      msg->snapshot.base = (Uint8)read8(&in);
+      msg->snapshot.length = (Uint8)read8(&in);
+      memcpy(msg->snapshot.data, in, msg->snapshot.length);
+      break;
+  }
+  return length;
+}
+
+// ============================================================================
+// encode the message with the human readable text format.
+static int encode_text(const Message* msg, Uint8* buffer, int size)
+{
+  char* out = (char*)buffer;
+  const char* name = TEXT_NAMES[msg->type];
+  int length = 0;
+  switch (msg->type) {
+    case MESSAGE_PING:
+      length = snprintf(out, size, "%s:%d|", name, msg->ping.time);
+      break;
+    case MESSAGE_PONG:
+      length = snprintf(out, size, "%s:%d:%d|", name, msg->pong.ping, msg->pong.pong);
+      break;
+    case MESSAGE_LEFT:
+    case MESSAGE_RIGHT:
+      length = snprintf(out, size, "%s:%d:%d:%d|",
+        name, msg->paddle.time, msg->paddle.x, msg->paddle.y);
+      break;
+    case MESSAGE_BALL:
+      length = snprintf(out, size, "%s:%d:%d:%d:%d:%d:%d|",
+        name, msg->ball.time, msg->ball.x, msg->ball.y,
+        msg->ball.direction_x, msg->ball.direction_y, msg->ball.velocity);
+      break;
+    case MESSAGE_RESET:
+      length = snprintf(out, size, "%s:%d:%d:%d:%d:%d:%d|",
+        name, msg->reset.time, msg->reset.countdown,
+        msg->reset.direction_x, msg->reset.direction_y,
+        msg->reset.left_points, msg->reset.right_points);
+      break;
+    case MESSAGE_START:
+      length = snprintf(out, size, "%s:%d:%d|", name, msg->start.time, msg->start.seed);
+      break;
+    case MESSAGE_INPUT:
+      length = snprintf(out, size, "%s:%d:%d:%d|",
+        name, msg->input.frame, msg->input.inputs, msg->input.ack);
+      break;
+    case MESSAGE_SNAPSHOT:
+      length = snprintf(out, size, "%s:%d:%d:%d:%d:%d:",
+        name, msg->snapshot.ack, msg->snapshot.input, msg->snapshot.tick,
+        msg->snapshot.base, msg->snapshot.length);
+      length = encode_hex(msg->snapshot.data, msg->snapshot.length, out, size, length);
+      break;
+    default:
+      length = snprintf(out, size, "%s|", name);
+      break;
+  }
+  return (length < 0 || length >= size) ? 0 : length;
+}
+
+// ============================================================================
+// split the next colon separated field from the text and move the cursor past it.
+static char* next_field(char** cursor)
+{
+  char* field = *cursor;
+  if (field == NULL) {
+    return NULL;
+  }
+  char* separator = strchr(field, ':');
+  if (separator == NULL) {
+    *cursor = NULL;
+  } else {
+    *separator = '\0';
+    *cursor = separator + 1;
+  }
+  return field;
+}
+
+// ============================================================================
+// decode a message with the human readable text format.
+static int decode_text(const Uint8* data, int size, Message* msg)
+{
+  // find the end of the message from the data.
+  const Uint8* end = memchr(data, PROTOCOL_TEXT_SEPARATOR, size);
+  if (end == NULL) {
+    return size >= PROTOCOL_MAX_MESSAGE_SIZE ? -1 : 0;
+  }
+  int length = (int)(end - data);
+  if (length >= PROTOCOL_MAX_MESSAGE_SIZE) {
+    return -1;
+  }
+
+  // copy the message into a null terminated buffer for the tokenization (without the
+  // global state of strtok as the multi-match workers decode messages in parallel).
+  char buffer[PROTOCOL_MAX_MESSAGE_SIZE];
+  memcpy(buffer, data, length);
+  buffer[length] = '\0';
+
+  // resolve the message type from the message name.
+  char* cursor = buffer;
+  char* token = next_field(&cursor);
+  if (token == NULL) {
+    return -1;
+  }
+  msg->type = MESSAGE_TYPE_COUNT;
+  for (int i = 0; i < MESSAGE_TYPE_COUNT; i++) {
+    if (strcmp(token, TEXT_NAMES[i]) == 0) {
+      msg->type = i;
+      break;
+    }
+  }
+  if (msg->type == MESSAGE_TYPE_COUNT) {
+    return -1;
+  }
+
+  // get all numeric fields of the message.
+  int fields[MAX_FIELDS];
+  for (int i = 0; i < TEXT_FIELDS[msg->type]; i++) {
+    token = next_field(&cursor);
+    if (token == NULL) {
+      return -1;
+    }
+    fields[i] = atoi(token);
+  }
+
+  switch (msg->type) {
+    case MESSAGE_PING:
+      msg->ping.time = fields[0];
+      break;
+    case MESSAGE_PONG:
+      msg->pong.ping = fields[0];
+      msg->pong.pong = fields[1];
+      break;
+    case MESSAGE_LEFT:
+    case MESSAGE_RIGHT:
+      msg->paddle.time = fields[0];
+      msg->paddle.x = fields[1];
+      msg->paddle.y = fields[2];
+      break;
+    case MESSAGE_BALL:
+      msg->ball.time = fields[0];
+      msg->ball.x = fields[1];
+      msg->ball.y = fields[2];
+      msg->ball.direction_x = fields[3];
+      msg->ball.direction_y = fields[4];
+      msg->ball.velocity = fields[5];
+      break;
+    case MESSAGE_RESET:
+      msg->reset.time = fields[0];
+      msg->reset.countdown = fields[1];
+      msg->reset.direction_x = fields[2];
+      msg->reset.direction_y = fields[3];
+      msg->reset.left_points = fields[4];
+      msg->reset.right_points = fields[5];
+      break;
+    case MESSAGE_START:
+      msg->start.time = fields[0];
+      msg->start.seed = fields[1];
+      break;
+    case MESSAGE_INPUT:
+      msg->input.frame = fields[0];
+      msg->input.inputs = fields[1];
+      msg->input.ack = fields[2];
+      break;
+    case MESSAGE_SNAPSHOT:
+      msg->snapshot.ack = fields[0];
+      msg->snapshot.input = fields[1];
+      msg->snapshot.tick = fields[2];
+      msg->snapshot.base = fields[3];
+      msg->snapshot.length = fields[4];
+      if (msg->snapshot.length < 0 || msg->snapshot.length > PROTOCOL_MAX_SNAPSHOT_DATA) {
+        return -1;
+      }
+      token = next_field(&cursor);
+      if (decode_hex(token, msg->snapshot.data, msg->snapshot.length) < 0) {
+        return -1;
+      }
+      break;
+  }
+  return length + 1;
+}
+
+// ============================================================================
+
+void protocol_set_format(int format)
+{
+  SDL_assert(format == BINARY || format == TEXT);
+  sFormat = format;
+}
+
+// ============================================================================
+
+int protocol_get_format()
+{
+  return sFormat;
+}
+
+// ============================================================================
+
+const char* protocol_get_name(int type)
+{
+  SDL_assert(type >= 0 && type < MESSAGE_TYPE_COUNT);
+  return TEXT_NAMES[type];
+}
+
+// ============================================================================
+
+int protocol_encode(const Message* msg, Uint8* buffer, int size)
+{
+  SDL_assert(msg != NULL);
+  SDL_assert(buffer != NULL);
+  SDL_assert(msg->type >= 0 && msg->type < MESSAGE_TYPE_COUNT);
+  return (sFormat == TEXT ? encode_text(msg, buffer, size) : encode_binary(msg, buffer, size));
+}
+
+// ============================================================================
+
+int protocol_decode(const Uint8* data, int size, Message* msg)
+{
+  SDL_assert(data != NULL);
+  SDL_assert(msg != NULL);
+  return (sFormat == TEXT ? decode_text(data, size, msg) : decode_binary(data, size, msg));
+}
+
+// ============================================================================
+
+int protocol_pack(const Message* msg, Uint8* buffer, int size)
+{
+  SDL_assert(msg != NULL);
+  SDL_assert(buffer != NULL);
+  SDL_assert(msg->type >= 0 && msg->type < MESSAGE_TYPE_COUNT);
+  return encode_binary(msg, buffer, size);
+}
+
+// ============================================================================
+
+int protocol_unpack(const Uint8* data, int size, Message* msg)
+{
+  SDL_assert(data != NULL);
+  SDL_assert(msg != NULL);
+  return decode_binary(data, size, msg);
+}
+
+// ============================================================================
+
+void protocol_write16(Uint8* buffer, Uint16 value)
+{
+  buffer[0] = (Uint8)(value & 0xff);
+  buffer[1] = (Uint8)(value >> 8);
+}
+
+// ============================================================================
+
+void protocol_write32(Uint8* buffer, Uint32 value)
+{
+  buffer[0] = (Uint8)(value & 0xff);
+  buffer[1] = (Uint8)((value >> 8) & 0xff);
+  buffer[2] = (Uint8)((value >> 16) & 0xff);
+  buffer[3] = (Uint8)(value >> 24);
+}
+
+// ============================================================================
+
+Uint16 protocol_read16(const Uint8* data)
+{
+  return (Uint16)(data[0] | (data[1] << 8));
+}
+
+// ============================================================================
+
+Uint32 protocol_read32(const Uint8* data)
+{
+  return (Uint32)data[0]
+    | ((Uint32)data[1] << 8)
+    | ((Uint32)data[2] << 16)
+    | ((Uint32)data[3] << 24);
+}
@@ -0,0 +1,165 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <SDL/SDL.h>
+
+// the version of the binary wire protocol.
+#define PROTOCOL_VERSION 2
+// the maximum size of a single encoded message in any format.
+#define PROTOCOL_MAX_MESSAGE_SIZE 192
+// the maximum amount of packed state bytes in a single snapshot message.
+#define PROTOCOL_MAX_SNAPSHOT_DATA 64
+// the separator character used to terminate text format messages.
+#define PROTOCOL_TEXT_SEPARATOR '|'
+
+// available network message types (opcodes).
+enum MessageType {
+  MESSAGE_HELLO,
+  MESSAGE_QUIT,
+  MESSAGE_PING,
+  MESSAGE_PONG,
+  MESSAGE_LEFT,
+  MESSAGE_RIGHT,
+  MESSAGE_BALL,
+  MESSAGE_RESET,
+  MESSAGE_GOAL,
+  MESSAGE_END,
+  MESSAGE_END_OK,
+  MESSAGE_START,
+  MESSAGE_INPUT,
+  MESSAGE_SNAPSHOT,
+  MESSAGE_TYPE_COUNT
+};
+// available wire formats for the network messages.
+enum Format { BINARY, TEXT };
+
+// ============================================================================
+
+typedef struct {
+  // the sender time of the ping request.
+  int time;
+} PingMessage;
+
+typedef struct {
+  // the sender time of the original ping request.
+  int ping;
+  // the sender time of the ping response.
+  int pong;
+} PongMessage;
+
+typedef struct {
+  // the timestamp of the paddle state.
+  int time;
+  // the x-coordinate of the paddle.
+  int x;
+  // the y-coordinate of the paddle.
+  int y;
+} PaddleMessage;
+
+typedef struct {
+  // the timestamp of the ball state.
+  int time;
+  // the x-coordinate of the ball.
+  int x;
+  // the y-coordinate of the ball.
+  int y;
+  // the movement direction in x-axis.
+  int direction_x;
+  // the movement direction in y-axis.
+  int direction_y;
+  // the movement speed.
+  int velocity;
+} BallMessage;
+
+typedef struct {
+  // the timestamp of the reset.
+  int time;
+  // the time when the ball should be launched.
+  int countdown;
+  // the new movement direction of the ball in x-axis.
+  int direction_x;
+  // the new movement direction of the ball in y-axis.
+  int direction_y;
+  // the points of the left player.
+  int left_points;
+  // the points of the right player.
+  int right_points;
+} ResetMessage;
+
+typedef struct {
+  // the synchronized time of the first frame.
+  int time;
+  // the seed of the deterministic simulation.
+  int seed;
+} StartMessage;
+
+typedef struct {
+  // the frame (or sequence number) of the newest input.
+  int frame;
+  // the inputs of the newest frames (two bits per frame, the newest lowest).
+  int inputs;
+  // the amount of remote frames with a received input (without gaps).
+  int ack;
+} InputMessage;
+
+typedef struct {
+  // the sequence number of the newest processed client input.
+  int ack;
+  // the most recent input of the server paddle.
+  int input;
+  // the simulation tick of the state.
+  int tick;
+  // the distance (in ticks) to the delta baseline state or zero for a keyframe.
+  int base;
+  // the amount of packed state bytes.
+  int length;
+  // the state packed as a delta against the baseline state.
+  Uint8 data[PROTOCOL_MAX_SNAPSHOT_DATA];
+} SnapshotMessage;
+
+typedef struct {
+  // the type of the message (see MessageType).
+  int type;
+  // the type specific message contents.
+  union {
+    PingMessage ping;
+    PongMessage pong;
+    PaddleMessage paddle;
+    BallMessage ball;
+    ResetMessage reset;
+    StartMessage start;
+    InputMessage input;
+    SnapshotMessage snapshot;
+  };
+} Message;
+
+// ============================================================================
+
+// select the wire format used to encode and decode messages.
+void protocol_set_format(int format);
+// get the wire format used to encode and decode messages.
+int protocol_get_format();
+// get the name of the message type (as used in the text format).
+const char* protocol_get_name(int type);
+
+// encode the message into the buffer and return the amount of written bytes.
+int protocol_encode(const Message* msg, Uint8* buffer, int size);
+// decode a message from the data and return the amount of consumed bytes.
+// returns zero when the data does not yet contain a complete message and -1
+// when the data contains a malformed message.
+int protocol_decode(const Uint8* data, int size, Message* msg);
+// encode the message with the binary format regardless of the selected format (e.g. for recordings).
+int protocol_pack(const Message* msg, Uint8* buffer, int size);
+// decode a message encoded with protocol_pack.
+int protocol_unpack(const Uint8* data, int size, Message* msg);
+
+// write a 16-bit little-endian value into the buffer.
+void protocol_write16(Uint8* buffer, Uint16 value);
+// write a 32-bit little-endian value into the buffer.
+void protocol_write32(Uint8* buffer, Uint32 value);
+// read a 16-bit little-endian value from the data.
+Uint16 protocol_read16(const Uint8* data);
+// read a 32-bit little-endian value from the data.
+Uint32 protocol_read32(const Uint8* data);
+
+#endif
@@ -0,0 +1,276 @@
+#include "record.h"
+
+#include <string.h>
+
+// ============================================================================
+// the main loop of the writer thread writing each handed over buffer.
+static int write_buffers(void* data)
+{
+  Recorder* recorder = data;
+  for (;;) {
+    SDL_SemWait(recorder->pending);
+    int writing = SDL_AtomicGet(&recorder->writing);
+    if (writing == 0 && SDL_AtomicGet(&recorder->running) == 0) {
+      return 0;
+    }
+    if (writing > 0) {
+      int index = writing - 1;
+      if ((int)fwrite(recorder->buffers[index], 1, recorder->sizes[index], recorder->file)
+        != recorder->sizes[index]) {
+        perror("fwrite");
+      }
+      fflush(recorder->file);
+      recorder->sizes[index] = 0;
+      SDL_AtomicSet(&recorder->writing, 0);
+    }
+  }
+}
+
+// ============================================================================
+// append an event into the active buffer which is known to have room for it.
+static void append(Recorder* recorder, int type, int time, const Uint8* data, int size)
+{
+  int* used = &recorder->sizes[recorder->active];
+  Uint8* buffer = recorder->buffers[recorder->active] + *used;
+  buffer[0] = (Uint8)type;
+  protocol_write16(buffer + 1, (Uint16)size);
+  protocol_write32(buffer + 3, (Uint32)time);
+  if (size > 0) {
+    memcpy(buffer + RECORD_EVENT_SIZE, data, size);
+  }
+  *used += RECORD_EVENT_SIZE + size;
+  recorder->bytes += RECORD_EVENT_SIZE + size;
+}
+
+// ============================================================================
+// append a gap event with the amount of events dropped since the previous event.
+static void append_gap(Recorder* recorder)
+{
+  Uint8 data[4];
+  protocol_write32(data, (Uint32)recorder->gap);
+  append(recorder, RECORD_GAP, recorder->gap_time, data, 4);
+  recorder->gap = 0;
+}
+
+// ============================================================================
+// hand the active buffer to the writer thread. returns zero when the thread is busy.
+static int swap_buffers(Recorder* recorder, int time)
+{
+  if (SDL_AtomicGet(&recorder->writing) != 0) {
+    return 0;
+  }
+  SDL_AtomicSet(&recorder->writing, recorder->active + 1);
+  recorder->active ^= 1;
+  recorder->flushed = time;
+  SDL_SemPost(recorder->pending);
+  return 1;
+}
+
+// ============================================================================
+
+int record_open(Recorder* recorder, const char* path, const RecordHeader* header)
+{
+  SDL_assert(recorder != NULL);
+  SDL_assert(path != NULL);
+  SDL_assert(header != NULL);
+
+  recorder->file = fopen(path, "wb");
+  if (recorder->file == NULL) {
+    perror("fopen");
+    return -1;
+  }
+  Uint8 data[RECORD_HEADER_SIZE];
+  memcpy(data, RECORD_MAGIC, 7);
+  data[7] = RECORD_VERSION;
+  protocol_write32(data + 8, (Uint32)header->mode);
+  protocol_write32(data + 12, (Uint32)header->netcode);
+  protocol_write32(data + 16, (Uint32)header->keyframe_interval);
+  protocol_write32(data + 20, header->seed);
+  protocol_write32(data + 24, (Uint32)header->time);
+  if (fwrite(data, 1, RECORD_HEADER_SIZE, recorder->file) != RECORD_HEADER_SIZE) {
+    perror("fwrite");
+    fclose(recorder->file);
+    return -1;
+  }
+
+  recorder->sizes[0] = 0;
+  recorder->sizes[1] = 0;
+  recorder->active = 0;
+  recorder->flushed = header->time;
+  recorder->direction = 0;
+  recorder->bytes = RECORD_HEADER_SIZE;
+  recorder->dropped = 0;
+  recorder->gap = 0;
+  recorder->gap_time = 0;
+  recorder->lossless = 0;
+  SDL_AtomicSet(&recorder->writing, 0);
+  SDL_AtomicSet(&recorder->running, 1);
+  recorder->pending = SDL_CreateSemaphore(0);
+  if (recorder->pending == NULL) {
+    printf("SDL_CreateSemaphore: %s\n", SDL_GetError());
+    fclose(recorder->file);
+    return -1;
+  }
+  recorder->thread = SDL_CreateThread(&write_buffers, "recorder", recorder);
+  if (recorder->thread == NULL) {
+    printf("SDL_CreateThread: %s\n", SDL_GetError());
+    SDL_DestroySemaphore(recorder->pending);
+    fclose(recorder->file);
+    return -1;
+  }
+  return 0;
+}
+
+// ============================================================================
+
+void record_close(Recorder* recorder)
+{
+  SDL_assert(recorder != NULL);
+  SDL_assert(recorder->file != NULL);
+
+  // hand over the last partial buffer and let the writer thread finish. the events
+  // dropped after it are marked with a gap into an emptied buffer.
+  for (int pass = 0; pass < 2; pass++) {
+    while (swap_buffers(recorder, recorder->flushed) == 0) {
+      SDL_Delay(1);
+    }
+    while (SDL_AtomicGet(&recorder->writing) != 0) {
+      SDL_Delay(1);
+    }
+    if (recorder->gap == 0) {
+      break;
+    }
+    append_gap(recorder);
+  }
+  SDL_AtomicSet(&recorder->running, 0);
+  SDL_SemPost(recorder->pending);
+  SDL_WaitThread(recorder->thread, NULL);
+  SDL_DestroySemaphore(recorder->pending);
+  fclose(recorder->file);
+  recorder->file = NULL;
+  printf("Recorded %d bytes with %d dropped event(s).\n", recorder->bytes, recorder->dropped);
+}
+
+// ============================================================================
+
+void record_event(Recorder* recorder, int type, int time, const Uint8* data, int size)
+{
+  SDL_assert(recorder != NULL);
+  SDL_assert(type >= 0 && type < RECORD_TYPE_COUNT);
+  SDL_assert(size >= 0 && size <= PROTOCOL_MAX_MESSAGE_SIZE);
+
+  // the buffer is handed over when full and after an interval to keep the file fresh.
+  int length = RECORD_EVENT_SIZE + size + (recorder->gap > 0 ? RECORD_EVENT_SIZE + 4 : 0);
+  int* used = &recorder->sizes[recorder->active];
+  if ((*used + length > RECORD_BUFFER_SIZE || time - recorder->flushed >= RECORD_FLUSH_INTERVAL)
+    && *used > 0) {
+    swap_buffers(recorder, time);
+    used = &recorder->sizes[recorder->active];
+  }
+
+  // a lossless recorder waits until the writer thread takes the full buffer.
+  while (recorder->lossless == 1 && *used + length > RECORD_BUFFER_SIZE) {
+    SDL_Delay(1);
+    swap_buffers(recorder, time);
+    used = &recorder->sizes[recorder->active];
+  }
+
+  // drop the event when the writer thread falls behind and mark the drops with a gap
+  // before the next event which fits so the replay knows the log is incomplete.
+  if (*used + length > RECORD_BUFFER_SIZE) {
+    if (recorder->gap == 0) {
+      recorder->gap_time = time;
+    }
+    recorder->gap++;
+    recorder->dropped++;
+    return;
+  }
+  if (recorder->gap > 0) {
+    append_gap(recorder);
+  }
+  append(recorder, type, time, data, size);
+}
+
+// ============================================================================
+
+void record_message(Recorder* recorder, int type, int time, const Message* msg)
+{
+  SDL_assert(msg != NULL);
+  SDL_assert(type == RECORD_RECEIVED || type == RECORD_SENT);
+
+  Uint8 data[PROTOCOL_MAX_MESSAGE_SIZE];
+  int size = protocol_pack(msg, data, PROTOCOL_MAX_MESSAGE_SIZE);
+  SDL_assert(size > 0);
+  record_event(recorder, type, time, data, size);
+}
+
+// ============================================================================
+
+void record_update(Recorder* recorder, int time, int step_time, int direction)
+{
+  SDL_assert(recorder != NULL);
+
+  if (direction != recorder->direction) {
+    Uint8 value = (Uint8)(Sint8)direction;
+    record_event(recorder, RECORD_INPUT, time, &value, 1);
+    recorder->direction = direction;
+  }
+  Uint8 data[4];
+  protocol_write32(data, (Uint32)step_time);
+  record_event(recorder, RECORD_UPDATE, time, data, 4);
+}
+
+// ============================================================================
+
+int record_read_header(const Uint8* data, int size, RecordHeader* header)
+{
+  SDL_assert(data != NULL);
+  SDL_assert(header != NULL);
+
+  if (size < RECORD_HEADER_SIZE || memcmp(data, RECORD_MAGIC, 7) != 0
+    || data[7] != RECORD_VERSION) {
+    return -1;
+  }
+  header->mode = (int)protocol_read32(data + 8);
+  header->netcode = (int)protocol_read32(data + 12);
+  header->keyframe_interval = (int)protocol_read32(data + 16);
+  header->seed = protocol_read32(data + 20);
+  header->time = (int)protocol_read32(data + 24);
+  return RECORD_HEADER_SIZE;
+}
+
+// ============================================================================
+
+int record_read_event(const Uint8* data, int size, RecordEvent* event)
+{
+  SDL_assert(data != NULL);
+  SDL_assert(event != NULL);
+
+  if (size == 0) {
+    return 0;
+  } else if (size < RECORD_EVENT_SIZE) {
+    return -1;
+  }
+  event->type = data[0];
+  event->size = protocol_read16(data + 1);
+  event->time = (int)protocol_read32(data + 3);
+  event->data = data + RECORD_EVENT_SIZE;
+  if (event->type >= RECORD_TYPE_COUNT || RECORD_EVENT_SIZE + event->size > size) {
+    return -1;
+  }
+  return RECORD_EVENT_SIZE + event->size;
+}
+
+// ============================================================================
+
+int record_read_value(const RecordEvent* event)
+{
+  SDL_assert(event != NULL);
+  SDL_assert(event->type == RECORD_INPUT || event->type == RECORD_UPDATE
+    || event->type == RECORD_GAP);
+
+  if (event->type == RECORD_INPUT) {
+    return (event->size == 1 ? (Sint8)event->data[0] : 0);
+  }
+  return (event->size == 4 ? (int)protocol_read32(event->data) : 0);
+}
@@ -0,0 +1,121 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <SDL/SDL.h>
+
+#include "protocol.h"
+
+#include <stdio.h>
+
+// the identifier at the beginning of each recording.
+#define RECORD_MAGIC "PONGREC"
+// the version of the recording format.
+#define RECORD_VERSION 1
+// the size of the recording header in bytes.
+#define RECORD_HEADER_SIZE 28
+// the size of the header (type, payload size and time) of each event in bytes.
+#define RECORD_EVENT_SIZE 7
+// the size of each of the two event buffers in bytes.
+#define RECORD_BUFFER_SIZE 65536
+// the interval (ms) after which a partially filled buffer is written.
+#define RECORD_FLUSH_INTERVAL 1000
+
+// the types of the recorded events.
+enum RecordType {
+  // the match was started.
+  RECORD_START,
+  // the match was polled for the pings and the end of the match.
+  RECORD_POLL,
+  // the local paddle direction changed (payload: the direction).
+  RECORD_INPUT,
+  // the match was updated by a timestep (payload: the synchronized step time).
+  RECORD_UPDATE,
+  // a message was received from the remote node (payload: the binary message).
+  RECORD_RECEIVED,
+  // a message was sent to the remote node (payload: the binary message).
+  RECORD_SENT,
+  // events were dropped while the writer thread fell behind (payload: the amount of events).
+  RECORD_GAP,
+  RECORD_TYPE_COUNT
+};
+
+typedef struct {
+  // the network mode (client/server) of the recording node.
+  int mode;
+  // the netcode selected on the recording node.
+  int netcode;
+  // the snapshot keyframe interval selected on the recording node.
+  int keyframe_interval;
+  // the seed of the random generator of the recording node.
+  Uint32 seed;
+  // the local time when the match was initialized.
+  int time;
+} RecordHeader;
+
+typedef struct {
+  // the type of the event.
+  int type;
+  // the local time of the event.
+  int time;
+  // the size of the payload in bytes.
+  int size;
+  // the payload of the event.
+  const Uint8* data;
+} RecordEvent;
+
+typedef struct {
+  // the recording file.
+  FILE* file;
+  // the two event buffers filled and written in turns.
+  Uint8 buffers[2][RECORD_BUFFER_SIZE];
+  // the amount of bytes in each buffer.
+  int sizes[2];
+  // the index of the buffer being filled.
+  int active;
+  // the index plus one of the buffer being written by the writer thread (zero when idle).
+  SDL_atomic_t writing;
+  // a definition whether the writer thread keeps running.
+  SDL_atomic_t running;
+  // the semaphore waking up the writer thread.
+  SDL_sem* pending;
+  // the thread writing the filled buffers into the file.
+  SDL_Thread* thread;
+  // the time when the buffer was last handed to the writer thread.
+  int flushed;
+  // the most recently recorded local paddle direction.
+  int direction;
+  // the amount of recorded bytes.
+  int bytes;
+  // the amount of events dropped while both buffers were full.
+  int dropped;
+  // the amount of dropped events not yet marked with a gap event.
+  int gap;
+  // the time of the first dropped event of the pending gap.
+  int gap_time;
+  // a definition whether to wait for the writer thread instead of dropping events
+  // (for runs on a virtual clock without a real-time deadline).
+  int lossless;
+} Recorder;
+
+// ============================================================================
+
+// create the recording file and start its writer thread. returns -1 on failure.
+int record_open(Recorder* recorder, const char* path, const RecordHeader* header);
+// write the remaining events and close the recording file.
+void record_close(Recorder* recorder);
+// append an event without blocking (dropped and marked with a gap when the writer thread
+// falls behind unless the recorder is lossless).
+void record_event(Recorder* recorder, int type, int time, const Uint8* data, int size);
+// append a message event in the binary format.
+void record_message(Recorder* recorder, int type, int time, const Message* msg);
+// append an update event and an input event when the local direction has changed.
+void record_update(Recorder* recorder, int time, int step_time, int direction);
+
+// read the recording header. returns the size of the header or -1 when not a recording.
+int record_read_header(const Uint8* data, int size, RecordHeader* header);
+// read the next event. returns the size of the event, zero at the end or -1 when truncated.
+int record_read_event(const Uint8* data, int size, RecordEvent* event);
+// get the value (direction, step time or dropped events) of an input, update or gap event.
+int record_read_value(const RecordEvent* event);
+
+#endif
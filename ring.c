@@ -0,0 +1,108 @@
+#include "ring.h"
+
+#include <string.h>
+
+// the mask used to map the buffer positions into the storage indices.
+#define RING_MASK (RING_BUFFER_SIZE - 1)
+
+// ============================================================================
+
+void ring_clear(RingBuffer* ring)
+{
+  SDL_assert(ring != NULL);
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+// ============================================================================
+
+int ring_size(const RingBuffer* ring)
+{
+  SDL_assert(ring != NULL);
+  return (int)(ring->head - ring->tail);
+}
+
+// ============================================================================
+
+int ring_reserve(RingBuffer* ring, Uint8** data)
+{
+  SDL_assert(ring != NULL);
+  SDL_assert(data != NULL);
+
+  // the free space ends either at the end of the storage or at the tail.
+  int index = ring->head & RING_MASK;
+  int free = RING_BUFFER_SIZE - ring_size(ring);
+  int contiguous = RING_BUFFER_SIZE - index;
+  *data = &ring->data[index];
+  return (free < contiguous ? free : contiguous);
+}
+
+// ============================================================================
+
+void ring_commit(RingBuffer* ring, int bytes)
+{
+  SDL_assert(ring != NULL);
+  SDL_assert(bytes >= 0);
+  SDL_assert(ring_size(ring) + bytes <= RING_BUFFER_SIZE);
+  ring->head += bytes;
+}
+
+// ============================================================================
+
+int ring_peek(const RingBuffer* ring, const Uint8** data)
+{
+  SDL_assert(ring != NULL);
+  SDL_assert(data != NULL);
+
+  // the data ends either at the end of the storage or at the head.
+  int index = ring->tail & RING_MASK;
+  int size = ring_size(ring);
+  int contiguous = RING_BUFFER_SIZE - index;
+  *data = &ring->data[index];
+  return (size < contiguous ? size : contiguous);
+}
+
+// ============================================================================
+
+void ring_consume(RingBuffer* ring, int bytes)
+{
+  SDL_assert(ring != NULL);
+  SDL_assert(bytes >= 0);
+  SDL_assert(bytes <= ring_size(ring));
+  ring->tail += bytes;
+}
+
+// ============================================================================
+
+int ring_next_message(RingBuffer* ring, Message* msg)
+{
+  SDL_assert(ring != NULL);
+  SDL_assert(msg != NULL);
+
+  // decode the message directly from the contiguous part of the buffer.
+  const Uint8* data = NULL;
+  int contiguous = ring_peek(ring, &data);
+  int length = protocol_decode(data, contiguous, msg);
+  if (length == 0) {
+    // a message may wrap around the end of the storage, so only then linearize
+    // the (small) beginning of the remaining data into a scratch buffer.
+    int size = ring_size(ring);
+    if (size > contiguous) {
+      Uint8 scratch[PROTOCOL_MAX_MESSAGE_SIZE];
+      int count = (size < PROTOCOL_MAX_MESSAGE_SIZE ? size : PROTOCOL_MAX_MESSAGE_SIZE);
+      int first = (contiguous < count ? contiguous : count);
+      memcpy(scratch, data, first);
+      memcpy(scratch + first, ring->data, count - first);
+      length = protocol_decode(scratch, count, msg);
+    }
+  }
+
+  if (length < 0) {
+    return -1;
+  } else if (length == 0) {
+    // a full buffer without a complete message can never be completed.
+    return (ring_size(ring) == RING_BUFFER_SIZE ? -1 : 0);
+  }
+  ring_consume(ring, length);
+  return length;
+}
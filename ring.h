@@ -0,0 +1,39 @@
+#ifndef RING_H
+#define RING_H
+
+#include <SDL/SDL.h>
+
+#include "protocol.h"
+
+// the size of the ring buffer in bytes (must be a power of two).
+#define RING_BUFFER_SIZE 4096
+
+typedef struct {
+  // the storage of the buffered data.
+  Uint8 data[RING_BUFFER_SIZE];
+  // the total amount of bytes written into the buffer.
+  Uint32 head;
+  // the total amount of bytes consumed from the buffer.
+  Uint32 tail;
+} RingBuffer;
+
+// ============================================================================
+
+// reset the ring buffer into an empty state.
+void ring_clear(RingBuffer* ring);
+// get the amount of unconsumed bytes in the ring buffer.
+int ring_size(const RingBuffer* ring);
+// get a pointer and the size of the contiguous free space in the ring buffer.
+int ring_reserve(RingBuffer* ring, Uint8** data);
+// mark the given amount of reserved bytes as written.
+void ring_commit(RingBuffer* ring, int bytes);
+// get a pointer and the size of the contiguous unconsumed data in the buffer.
+int ring_peek(const RingBuffer* ring, const Uint8** data);
+// mark the given amount of bytes as consumed.
+void ring_consume(RingBuffer* ring, int bytes);
+// decode the next complete message from the ring buffer without copying.
+// returns the length of the decoded message, 0 when the buffer does not contain
+// a complete message and -1 when the buffer contains a malformed message.
+int ring_next_message(RingBuffer* ring, Message* msg);
+
+#endif
@@ -0,0 +1,181 @@
+#include "rollback.h"
+#include "game.h"
+#include "metrics.h"
+
+// the amount of bits used to pack a single input into an input message.
+#define INPUT_BITS 2
+
+// ============================================================================
+// get the remote input for the frame or predict it from the previous frame.
+static int remote_input(const Rollback* rollback, int frame)
+{
+  int index = frame % ROLLBACK_INPUT_BUFFER;
+  if (rollback->remote_frames[index] == frame) {
+    return rollback->remote_inputs[index];
+  } else if (frame == 0) {
+    return NONE;
+  }
+  return rollback->used_inputs[(frame - 1) % ROLLBACK_INPUT_BUFFER];
+}
+
+// ============================================================================
+// simulate the next frame with the stored local input.
+static void simulate(Rollback* rollback)
+{
+  int frame = rollback->frame;
+  int index = frame % ROLLBACK_INPUT_BUFFER;
+  int remote = remote_input(rollback, frame);
+  rollback->used_inputs[index] = (Sint8)remote;
+
+  SimInput input;
+  input.left = (rollback->side == 0 ? rollback->local_inputs[index] : remote);
+  input.right = (rollback->side == 0 ? remote : rollback->local_inputs[index]);
+  sim_step(&rollback->states[frame % ROLLBACK_WINDOW], &input,
+    &rollback->states[(frame + 1) % ROLLBACK_WINDOW]);
+  rollback->frame++;
+}
+
+// ============================================================================
+// store a single received remote input.
+static void receive_input(Rollback* rollback, int frame, int input)
+{
+  // skip inputs which are already known or too far in the future.
+  if (frame < rollback->confirmed || frame >= rollback->confirmed + ROLLBACK_INPUT_BUFFER) {
+    return;
+  }
+  int index = frame % ROLLBACK_INPUT_BUFFER;
+  rollback->remote_frames[index] = frame;
+  rollback->remote_inputs[index] = (Sint8)input;
+
+  // rewind to the frame when the prediction turned out to be wrong.
+  if (frame < rollback->frame && rollback->used_inputs[index] != input) {
+    if (rollback->rewind < 0 || frame < rollback->rewind) {
+      rollback->rewind = frame;
+    }
+  }
+}
+
+// ============================================================================
+
+void rollback_init(Rollback* rollback, int side, int start_time, Uint32 seed)
+{
+  SDL_assert(rollback != NULL);
+  SDL_assert(side == 0 || side == 1);
+
+  SDL_memset(rollback, 0, sizeof(Rollback));
+  rollback->enabled = 1;
+  rollback->side = side;
+  rollback->start_time = start_time;
+  rollback->rewind = -1;
+  for (int i = 0; i < ROLLBACK_INPUT_BUFFER; i++) {
+    rollback->remote_frames[i] = -1;
+  }
+  sim_init(&rollback->states[0], seed);
+}
+
+// ============================================================================
+
+int rollback_frame_at(const Rollback* rollback, int time)
+{
+  SDL_assert(rollback != NULL);
+  if (time < rollback->start_time) {
+    return -1;
+  }
+  return (time - rollback->start_time) / TIMESTEP;
+}
+
+// ============================================================================
+
+int rollback_can_advance(const Rollback* rollback)
+{
+  SDL_assert(rollback != NULL);
+
+  // the oldest unconfirmed frame must stay within the state history.
+  return rollback->frame - rollback->confirmed < ROLLBACK_WINDOW - 1;
+}
+
+// ============================================================================
+
+void rollback_advance(Rollback* rollback, int input)
+{
+  SDL_assert(rollback != NULL);
+  SDL_assert(rollback_can_advance(rollback));
+
+  rollback->local_inputs[rollback->frame % ROLLBACK_INPUT_BUFFER] = (Sint8)input;
+  simulate(rollback);
+}
+
+// ============================================================================
+
+void rollback_receive(Rollback* rollback, int frame, int inputs, int ack)
+{
+  SDL_assert(rollback != NULL);
+
+  // unpack the inputs of the newest frame and its preceding frames.
+  for (int i = ROLLBACK_INPUT_HISTORY - 1; i >= 0; i--) {
+    if (frame - i >= 0) {
+      receive_input(rollback, frame - i, sim_unpack_input((inputs >> (i * INPUT_BITS)) & 3));
+    }
+  }
+
+  // move the confirmed frame forward over all received inputs.
+  while (rollback->remote_frames[rollback->confirmed % ROLLBACK_INPUT_BUFFER] == rollback->confirmed) {
+    rollback->confirmed++;
+  }
+  if (ack > rollback->remote_ack) {
+    rollback->remote_ack = SDL_min(ack, rollback->frame);
+  }
+}
+
+// ============================================================================
+
+void rollback_resolve(Rollback* rollback)
+{
+  SDL_assert(rollback != NULL);
+  if (rollback->rewind < 0) {
+    return;
+  }
+
+  // restore the state before the misprediction and simulate again up to now.
+  int target = rollback->frame;
+  rollback->frame = rollback->rewind;
+  rollback->rewind = -1;
+  rollback->rollbacks++;
+  rollback->resimulated += target - rollback->frame;
+  metrics_observe(METRIC_ROLLBACK_FRAMES, target - rollback->frame);
+  while (rollback->frame < target) {
+    simulate(rollback);
+  }
+}
+
+// ============================================================================
+
+int rollback_local_inputs(const Rollback* rollback, int frame)
+{
+  SDL_assert(rollback != NULL);
+  SDL_assert(frame < rollback->frame);
+
+  int inputs = 0;
+  for (int i = 0; i < ROLLBACK_INPUT_HISTORY && frame - i >= 0; i++) {
+    int input = rollback->local_inputs[(frame - i) % ROLLBACK_INPUT_BUFFER];
+    inputs |= sim_pack_input(input) << (i * INPUT_BITS);
+  }
+  return inputs;
+}
+
+// ============================================================================
+
+const SimState* rollback_state(const Rollback* rollback)
+{
+  SDL_assert(rollback != NULL);
+  return &rollback->states[rollback->frame % ROLLBACK_WINDOW];
+}
+
+// ============================================================================
+
+const SimState* rollback_confirmed_state(const Rollback* rollback)
+{
+  SDL_assert(rollback != NULL);
+  int frame = SDL_min(rollback->confirmed, rollback->frame);
+  return &rollback->states[frame % ROLLBACK_WINDOW];
+}
@@ -0,0 +1,67 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "sim.h"
+
+// the amount of past simulation states kept for re-simulation.
+#define ROLLBACK_WINDOW 32
+// the amount of frames stored in the input buffers (past and future frames).
+#define ROLLBACK_INPUT_BUFFER (ROLLBACK_WINDOW * 2)
+// the amount of frames included into a single input message.
+#define ROLLBACK_INPUT_HISTORY 8
+// the delay (milliseconds) between a match start request and its first frame.
+#define ROLLBACK_START_DELAY 500
+
+typedef struct {
+  // a definition whether the rollback mode is in use.
+  int enabled;
+  // the side (0 = left, 1 = right) controlled by the local player.
+  int side;
+  // the synchronized time of the first frame.
+  int start_time;
+  // the next frame to be simulated.
+  int frame;
+  // the amount of frames with a received remote input (without gaps).
+  int confirmed;
+  // the amount of local frames acknowledged by the remote node.
+  int remote_ack;
+  // the earliest frame that must be re-simulated (-1 for none).
+  int rewind;
+  // the simulation states at the beginning of each frame.
+  SimState states[ROLLBACK_WINDOW];
+  // the local inputs of each frame.
+  Sint8 local_inputs[ROLLBACK_INPUT_BUFFER];
+  // the remote inputs (received or predicted) used to simulate each frame.
+  Sint8 used_inputs[ROLLBACK_INPUT_BUFFER];
+  // the received remote inputs of each frame.
+  Sint8 remote_inputs[ROLLBACK_INPUT_BUFFER];
+  // the frame of each received remote input (-1 for none).
+  int remote_frames[ROLLBACK_INPUT_BUFFER];
+  // the amount of performed rollbacks.
+  int rollbacks;
+  // the amount of frames simulated again due to rollbacks.
+  int resimulated;
+} Rollback;
+
+// ============================================================================
+
+// initialize the rollback to start a match from the given time and seed.
+void rollback_init(Rollback* rollback, int side, int start_time, Uint32 seed);
+// get the frame that should be simulated at the given synchronized time.
+int rollback_frame_at(const Rollback* rollback, int time);
+// check whether the next frame can be simulated without losing the history.
+int rollback_can_advance(const Rollback* rollback);
+// simulate the next frame with the local input and a predicted remote input.
+void rollback_advance(Rollback* rollback, int input);
+// store the received remote inputs and the acknowledgement from the remote node.
+void rollback_receive(Rollback* rollback, int frame, int inputs, int ack);
+// re-simulate all frames after the earliest mispredicted remote input.
+void rollback_resolve(Rollback* rollback);
+// get the packed local inputs of the given frame and the preceding frames.
+int rollback_local_inputs(const Rollback* rollback, int frame);
+// get the most recent (predicted) simulation state.
+const SimState* rollback_state(const Rollback* rollback);
+// get the most recent simulation state which is based only on received inputs.
+const SimState* rollback_confirmed_state(const Rollback* rollback);
+
+#endif
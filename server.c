@@ -0,0 +1,780 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "server.h"
+#include "channel.h"
+#include "game.h"
+#include "metrics.h"
+#include "ring.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// the maximum amount of events to handle with a single epoll wait.
+#define SERVER_MAX_EVENTS 256
+// the size of the outgoing message buffer for each connection.
+#define SERVER_OUTPUT_SIZE 4096
+// the amount of buckets in the table used to find UDP connections by address.
+#define SERVER_ADDRESS_BUCKETS 2048
+// the amount of milliseconds without any data until a client is dropped.
+#define SERVER_TIMEOUT_MS 5000
+// the tick duration (microseconds) after which a worker is at risk of missing its deadline.
+#define SERVER_OVERLOAD_US (TIMESTEP * 1000 * 3 / 4)
+// the tick duration (microseconds) below which a worker may steal matches from others.
+#define SERVER_IDLE_US (TIMESTEP * 1000 / 4)
+// the maximum amount of matches handed over with a single steal.
+#define SERVER_MAX_STEAL 64
+
+typedef struct Connection Connection;
+typedef struct Worker Worker;
+
+struct Connection {
+  // a definition whether the connection slot is in use.
+  int used;
+  // the TCP socket of the client (-1 with UDP).
+  int fd;
+  // the UDP address of the client.
+  struct sockaddr_in address;
+  // the next connection in the same address table bucket (UDP) or inbox (TCP).
+  Connection* next;
+  // the worker currently owning the connection.
+  Worker* worker;
+  // the time when data was last received from the client.
+  int last_receive_ticks;
+  // the match played with the client.
+  Match match;
+  // the reliable channel used to deliver the control messages over UDP.
+  Channel channel;
+  // the ring buffer for incoming TCP stream data.
+  RingBuffer input;
+  // the buffer for outgoing messages batched during a tick.
+  Uint8 output[SERVER_OUTPUT_SIZE];
+  // the amount of batched bytes in the outgoing buffer.
+  int output_size;
+};
+
+struct Worker {
+  // the index of the worker.
+  int index;
+  // the thread running the worker loop.
+  SDL_Thread* thread;
+  // the epoll instance used to listen for socket activities.
+  int epoll;
+  // the socket used to listen TCP connections or to receive UDP packets.
+  int socket;
+  // the connections (matches) owned by the worker.
+  Connection** connections;
+  // the amount of connections owned by the worker.
+  int count;
+  // the UDP connections hashed by their address.
+  Connection* address_table[SERVER_ADDRESS_BUCKETS];
+  // the amount of owned connections published for the other workers.
+  SDL_atomic_t published_count;
+  // the duration (microseconds) of the most recent tick published for the other workers.
+  SDL_atomic_t load;
+  // the index (plus one) of a worker which requests to steal matches.
+  SDL_atomic_t steal_request;
+  // the lock guarding the inbox.
+  SDL_mutex* inbox_lock;
+  // the connections handed over to this worker by other workers.
+  Connection* inbox;
+  // the amount of ticks run by the worker.
+  int ticks;
+  // the amount of ticks which missed their deadline.
+  int overruns;
+  // the amount of matches stolen from other workers.
+  int stolen;
+};
+
+// ============================================================================
+
+// the network transport mode (TCP/UDP) of the server.
+static int sTransport = TCP;
+// a definition whether the workers should keep running.
+static SDL_atomic_t sRunning;
+// the worker threads of the server.
+static Worker* sWorkers = NULL;
+// the amount of worker threads.
+static int sWorkerCount = 0;
+// the connection slots shared by all workers.
+static Connection* sConnections = NULL;
+// the stack of free connection slots.
+static Connection** sFreeConnections = NULL;
+// the amount of free connection slots.
+static int sFreeCount = 0;
+// the lock guarding the free connection slots.
+static SDL_mutex* sPoolLock = NULL;
+
+// ============================================================================
+// get the current time in microseconds (divided first to not overflow with a GHz counter).
+static Uint64 micros()
+{
+  Uint64 counter = SDL_GetPerformanceCounter();
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  return (counter / frequency) * 1000000 + (counter % frequency) * 1000000 / frequency;
+}
+
+// ============================================================================
+// get the address table bucket index of the given UDP address.
+static int address_bucket(const struct sockaddr_in* address)
+{
+  Uint32 hash = (Uint32)address->sin_addr.s_addr * 2654435761u;
+  hash ^= (Uint32)address->sin_port * 40503u;
+  return (int)(hash % SERVER_ADDRESS_BUCKETS);
+}
+
+// ============================================================================
+// find a UDP connection of the worker with the given address.
+static Connection* address_find(Worker* worker, const struct sockaddr_in* address)
+{
+  Connection* connection = worker->address_table[address_bucket(address)];
+  while (connection != NULL) {
+    if (connection->address.sin_addr.s_addr == address->sin_addr.s_addr
+      && connection->address.sin_port == address->sin_port) {
+      return connection;
+    }
+    connection = connection->next;
+  }
+  return NULL;
+}
+
+// ============================================================================
+// remove the UDP connection from the address table of its worker.
+static void address_remove(Connection* connection)
+{
+  Connection** link = &connection->worker->address_table[address_bucket(&connection->address)];
+  while (*link != NULL) {
+    if (*link == connection) {
+      *link = connection->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+  connection->next = NULL;
+}
+
+// ============================================================================
+// send all batched messages of the connection to the client.
+static void connection_flush(Connection* connection)
+{
+  // acks and retransmissions are sent even without any new UDP messages.
+  int now = SDL_GetTicks();
+  if (connection->output_size == 0
+    && (sTransport == TCP || channel_has_output(&connection->channel, now) == 0)) {
+    return;
+  }
+
+  if (sTransport == UDP) {
+    // a UDP batch is always sent as a single packet with the channel header.
+    Uint8 packet[NETWORK_MTU];
+    int size = connection->output_size;
+    int length = channel_write(&connection->channel, packet, NETWORK_MTU - size, now);
+    memcpy(packet + length, connection->output, size);
+    sendto(connection->worker->socket, packet, length + size, 0,
+      (struct sockaddr*)&connection->address, sizeof(connection->address));
+    connection->output_size = 0;
+    return;
+  }
+
+  // send as much as the socket accepts and keep the rest for the next tick.
+  ssize_t sent = send(connection->fd, connection->output, connection->output_size, MSG_NOSIGNAL);
+  if (sent < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      connection->match.state = STOPPED;
+    }
+    return;
+  }
+  memmove(connection->output, connection->output + sent, connection->output_size - sent);
+  connection->output_size -= (int)sent;
+}
+
+// ============================================================================
+// batch the given message to be sent to the client of the match.
+static void connection_send(Match* match, const Message* msg)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(msg != NULL);
+
+  // control messages are queued into the reliable channel with UDP.
+  Connection* connection = match->connection;
+  if (sTransport == UDP && channel_is_reliable(msg->type) == 1) {
+    if (channel_queue(&connection->channel, msg) < 0) {
+      printf("Dropping a client which does not acknowledge messages.\n");
+      match->state = STOPPED;
+    }
+    return;
+  }
+
+  // split the batch at the MTU with UDP and at the buffer size with TCP.
+  int limit = (sTransport == UDP ? NETWORK_MTU - CHANNEL_RESERVED_SIZE : SERVER_OUTPUT_SIZE);
+  int size = protocol_encode(msg, connection->output + connection->output_size,
+    limit - connection->output_size);
+  if (size == 0) {
+    connection_flush(connection);
+    size = protocol_encode(msg, connection->output + connection->output_size,
+      limit - connection->output_size);
+  }
+
+  // a client that does not read its data fast enough is dropped.
+  if (size == 0) {
+    printf("Dropping a client with a full output buffer.\n");
+    match->state = STOPPED;
+    return;
+  }
+  metrics_count_sent(msg->type, size);
+  connection->output_size += size;
+}
+
+// ============================================================================
+// add the connection into the set of connections owned by the worker.
+static void worker_attach(Worker* worker, Connection* connection)
+{
+  SDL_assert(worker->count < SERVER_MAX_MATCHES);
+  connection->worker = worker;
+  worker->connections[worker->count++] = connection;
+  if (connection->fd >= 0) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = connection;
+    if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, connection->fd, &event) != 0) {
+      perror("epoll_ctl");
+      connection->match.state = STOPPED;
+    }
+  }
+}
+
+// ============================================================================
+// remove the connection at the given index from the worker.
+static Connection* worker_detach(Worker* worker, int index)
+{
+  SDL_assert(index >= 0 && index < worker->count);
+  Connection* connection = worker->connections[index];
+  worker->connections[index] = worker->connections[--worker->count];
+  if (connection->fd >= 0) {
+    epoll_ctl(worker->epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+  }
+  return connection;
+}
+
+// ============================================================================
+// reserve a new connection slot and start a match for it in the worker.
+static Connection* connection_open(Worker* worker, int fd, const struct sockaddr_in* address)
+{
+  // take a free connection slot from the shared pool.
+  Connection* connection = NULL;
+  int running = 0;
+  SDL_LockMutex(sPoolLock);
+  if (sFreeCount > 0) {
+    connection = sFreeConnections[--sFreeCount];
+    running = SERVER_MAX_MATCHES - sFreeCount;
+  }
+  SDL_UnlockMutex(sPoolLock);
+  if (connection == NULL) {
+    printf("Server is full: Rejecting a new client...\n");
+    return NULL;
+  }
+
+  connection->used = 1;
+  connection->fd = fd;
+  connection->address = *address;
+  connection->next = NULL;
+  connection->last_receive_ticks = SDL_GetTicks();
+  connection->output_size = 0;
+  ring_clear(&connection->input);
+  channel_init(&connection->channel);
+  match_init(&connection->match, SERVER, &connection_send, connection);
+  worker_attach(worker, connection);
+
+  if (sTransport == UDP) {
+    int bucket = address_bucket(address);
+    connection->next = worker->address_table[bucket];
+    worker->address_table[bucket] = connection;
+  }
+
+  char host[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &address->sin_addr, host, sizeof(host));
+  printf("A client joined worker %d from %s:%d [%d match(es) running].\n",
+    worker->index, host, ntohs(address->sin_port), running);
+  match_start(&connection->match);
+  return connection;
+}
+
+// ============================================================================
+// close the connection and release its slot back into the shared pool.
+static void connection_close(Connection* connection)
+{
+  SDL_assert(connection->used == 1);
+
+  if (sTransport == UDP) {
+    // inform the client with a single attempt as the slot is released right away.
+    Message msg = { .type = MESSAGE_QUIT };
+    connection_send(&connection->match, &msg);
+    connection_flush(connection);
+    address_remove(connection);
+  } else {
+    connection_flush(connection);
+    close(connection->fd);
+  }
+
+  printf("A match ended with results %d - %d.\n",
+    connection->match.left_points, connection->match.right_points);
+  connection->used = 0;
+  connection->fd = -1;
+  connection->worker = NULL;
+
+  SDL_LockMutex(sPoolLock);
+  sFreeConnections[sFreeCount++] = connection;
+  SDL_UnlockMutex(sPoolLock);
+}
+
+// ============================================================================
+// accept all pending TCP connections of the worker.
+static void tcp_accept(Worker* worker)
+{
+  for (;;) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int fd = accept4(worker->socket, (struct sockaddr*)&address, &length, SOCK_NONBLOCK);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("accept4");
+      }
+      return;
+    }
+
+    // game messages are small and latency sensitive.
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    if (connection_open(worker, fd, &address) == NULL) {
+      close(fd);
+    }
+  }
+}
+
+// ============================================================================
+// receive and dispatch all pending data from the TCP connection.
+static void tcp_read(Connection* connection)
+{
+  for (;;) {
+    // receive the incoming stream data directly into the free space of the ring.
+    Uint8* space = NULL;
+    int capacity = ring_reserve(&connection->input, &space);
+    ssize_t bytes = recv(connection->fd, space, capacity, 0);
+    if (bytes == 0) {
+      connection->match.state = STOPPED;
+      return;
+    } else if (bytes < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        connection->match.state = STOPPED;
+      }
+      return;
+    }
+    ring_commit(&connection->input, (int)bytes);
+    connection->last_receive_ticks = SDL_GetTicks();
+
+    // process all complete messages from the received data stream.
+    Message msg;
+    int result = 0;
+    while ((result = ring_next_message(&connection->input, &msg)) > 0) {
+      metrics_count_received(msg.type, result);
+      match_dispatch(&connection->match, &msg);
+    }
+    if (result < 0) {
+      printf("Received a malformed TCP message: Dropping the client...\n");
+      connection->match.state = STOPPED;
+      return;
+    }
+  }
+}
+
+// ============================================================================
+// check whether the UDP packet starts a new connection with a hello message.
+static int is_hello(const Uint8* data, int size)
+{
+  Message msg;
+  return channel_peek(data, size, &msg) == 1 && msg.type == MESSAGE_HELLO;
+}
+
+// ============================================================================
+// receive and dispatch all pending UDP packets of the worker.
+static void udp_read(Worker* worker)
+{
+  Uint8 buffer[NETWORK_BUFFER_SIZE];
+  for (;;) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    ssize_t bytes = recvfrom(worker->socket, buffer, sizeof(buffer), 0,
+      (struct sockaddr*)&address, &length);
+    if (bytes < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("recvfrom");
+      }
+      return;
+    }
+
+    // only a hello message from an unknown address starts a new match.
+    Message msg;
+    Connection* connection = address_find(worker, &address);
+    if (connection == NULL) {
+      if (is_hello(buffer, (int)bytes) == 0) {
+        continue;
+      }
+      connection = connection_open(worker, -1, &address);
+      if (connection == NULL) {
+        continue;
+      }
+    }
+    connection->last_receive_ticks = SDL_GetTicks();
+
+    // skip duplicated, too old and malformed packets.
+    int offset = channel_read(&connection->channel, buffer, (int)bytes, SDL_GetTicks());
+    if (offset < 0) {
+      continue;
+    }
+
+    // dispatch the reliable messages in order before the unreliable ones.
+    while (channel_next(&connection->channel, &msg) == 1) {
+      match_dispatch(&connection->match, &msg);
+    }
+
+    // decode and dispatch all messages directly from the packet contents.
+    while (offset < bytes) {
+      int size = protocol_decode(buffer + offset, (int)bytes - offset, &msg);
+      if (size <= 0) {
+        break;
+      }
+      offset += size;
+      metrics_count_received(msg.type, size);
+      match_dispatch(&connection->match, &msg);
+    }
+  }
+}
+
+// ============================================================================
+// open the non-blocking server socket of the worker and register it into the epoll.
+static void open_socket(Worker* worker)
+{
+  worker->socket = socket(AF_INET, (sTransport == TCP ? SOCK_STREAM : SOCK_DGRAM) | SOCK_NONBLOCK, 0);
+  if (worker->socket < 0) {
+    perror("socket");
+    exit(EXIT_FAILURE);
+  }
+
+  // each worker binds its own socket and the kernel balances the clients among them.
+  int flag = 1;
+  setsockopt(worker->socket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  if (setsockopt(worker->socket, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof(flag)) != 0) {
+    perror("setsockopt(SO_REUSEPORT)");
+    exit(EXIT_FAILURE);
+  }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(NETWORK_PORT);
+  if (bind(worker->socket, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    perror("bind");
+    exit(EXIT_FAILURE);
+  }
+  if (sTransport == TCP && listen(worker->socket, SOMAXCONN) != 0) {
+    perror("listen");
+    exit(EXIT_FAILURE);
+  }
+
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = NULL;
+  if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->socket, &event) != 0) {
+    perror("epoll_ctl");
+    exit(EXIT_FAILURE);
+  }
+}
+
+// ============================================================================
+// ask the most overloaded worker to hand over matches when this worker is idle.
+static void steal_request(Worker* worker)
+{
+  // UDP clients are pinned to the worker whose socket receives their packets.
+  if (sTransport == UDP || SDL_AtomicGet(&worker->load) > SERVER_IDLE_US) {
+    return;
+  }
+
+  Worker* victim = NULL;
+  int victimLoad = SERVER_OVERLOAD_US;
+  for (int i = 0; i < sWorkerCount; i++) {
+    int load = SDL_AtomicGet(&sWorkers[i].load);
+    if (&sWorkers[i] != worker && load > victimLoad) {
+      victim = &sWorkers[i];
+      victimLoad = load;
+    }
+  }
+  if (victim != NULL) {
+    SDL_AtomicCAS(&victim->steal_request, 0, worker->index + 1);
+  }
+}
+
+// ============================================================================
+// hand over matches into the inbox of a worker which has requested to steal.
+static void steal_respond(Worker* worker)
+{
+  int request = SDL_AtomicSet(&worker->steal_request, 0);
+  if (request == 0 || SDL_AtomicGet(&worker->load) <= SERVER_OVERLOAD_US) {
+    return;
+  }
+
+  // balance the amount of matches between the workers.
+  Worker* thief = &sWorkers[request - 1];
+  int amount = (worker->count - SDL_AtomicGet(&thief->published_count)) / 2;
+  amount = SDL_min(amount, SERVER_MAX_STEAL);
+  if (amount <= 0) {
+    return;
+  }
+
+  SDL_LockMutex(thief->inbox_lock);
+  for (int i = 0; i < amount; i++) {
+    Connection* connection = worker_detach(worker, worker->count - 1);
+    connection->worker = thief;
+    connection->next = thief->inbox;
+    thief->inbox = connection;
+  }
+  SDL_UnlockMutex(thief->inbox_lock);
+  SDL_AtomicSet(&worker->published_count, worker->count);
+}
+
+// ============================================================================
+// take the ownership of all matches handed over to the worker.
+static void steal_adopt(Worker* worker)
+{
+  SDL_LockMutex(worker->inbox_lock);
+  Connection* connection = worker->inbox;
+  worker->inbox = NULL;
+  SDL_UnlockMutex(worker->inbox_lock);
+
+  while (connection != NULL) {
+    Connection* next = connection->next;
+    connection->next = NULL;
+    worker_attach(worker, connection);
+    worker->stolen++;
+    connection = next;
+  }
+  SDL_AtomicSet(&worker->published_count, worker->count);
+}
+
+// ============================================================================
+// update all matches of the worker with a single fixed timestep.
+static void tick(Worker* worker)
+{
+  int ticks = SDL_GetTicks();
+  for (int i = worker->count - 1; i >= 0; i--) {
+    Connection* connection = worker->connections[i];
+
+    // drop clients which have silently disappeared.
+    Match* match = &connection->match;
+    if (ticks - connection->last_receive_ticks > SERVER_TIMEOUT_MS) {
+      printf("A client timed out: Closing the match...\n");
+      match->state = STOPPED;
+    }
+
+    if (match->state == RUNNING) {
+      match_poll(match);
+    }
+    if (match->state == RUNNING) {
+      int time = match_ticks(match);
+      match_update(match, time);
+      match->previous_tick = time;
+      connection_flush(connection);
+    }
+    if (match->state != RUNNING) {
+      worker_detach(worker, i);
+      connection_close(connection);
+    }
+  }
+  SDL_AtomicSet(&worker->published_count, worker->count);
+}
+
+// ============================================================================
+// the main loop of a single worker thread.
+static int worker_run(void* data)
+{
+  Worker* worker = data;
+  int nextTick = SDL_GetTicks() + TIMESTEP;
+  struct epoll_event events[SERVER_MAX_EVENTS];
+  while (SDL_AtomicGet(&sRunning) == 1) {
+    // sleep on the sockets until the next tick unless data arrives.
+    int timeout = nextTick - (int)SDL_GetTicks();
+    int count = epoll_wait(worker->epoll, events, SERVER_MAX_EVENTS, (timeout > 0 ? timeout : 0));
+    if (count < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      break;
+    }
+
+    // handle all sockets with pending activity.
+    for (int i = 0; i < count; i++) {
+      Connection* connection = events[i].data.ptr;
+      if (connection == NULL) {
+        if (sTransport == TCP) {
+          tcp_accept(worker);
+        } else {
+          udp_read(worker);
+        }
+      } else if (connection->used == 1 && connection->worker == worker) {
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          connection->match.state = STOPPED;
+        } else {
+          tcp_read(connection);
+        }
+      }
+    }
+
+    // take over matches handed over by other workers.
+    steal_adopt(worker);
+
+    // update all matches with a fixed timestep and measure the spent time.
+    int ticks = SDL_GetTicks();
+    if (ticks >= nextTick) {
+      Uint64 started = micros();
+      Uint64 traced = trace_begin();
+      tick(worker);
+      trace_end("server", "tick", traced);
+      int load = (int)(micros() - started);
+      SDL_AtomicSet(&worker->load, load);
+      metrics_observe(METRIC_TICK_TIME, load);
+      worker->ticks++;
+
+      nextTick += TIMESTEP;
+      if (nextTick <= ticks) {
+        worker->overruns++;
+        metrics_add(METRIC_TICK_OVERRUNS, 1);
+        nextTick = ticks + TIMESTEP;
+      }
+
+      // balance the matches among the workers.
+      steal_respond(worker);
+      steal_request(worker);
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+
+void server_run(int transport, int workers)
+{
+  SDL_assert(transport == TCP || transport == UDP);
+  sTransport = transport;
+  sWorkerCount = (workers > 0 ? workers : SDL_GetCPUCount());
+  sWorkerCount = SDL_max(1, SDL_min(sWorkerCount, SERVER_MAX_WORKERS));
+
+  // allocate the connection slots shared by all workers.
+  sConnections = SDL_calloc(SERVER_MAX_MATCHES, sizeof(Connection));
+  sFreeConnections = SDL_calloc(SERVER_MAX_MATCHES, sizeof(Connection*));
+  sWorkers = SDL_calloc(sWorkerCount, sizeof(Worker));
+  sPoolLock = SDL_CreateMutex();
+  if (sConnections == NULL || sFreeConnections == NULL || sWorkers == NULL || sPoolLock == NULL) {
+    printf("Unable to allocate %d connection slots!\n", SERVER_MAX_MATCHES);
+    exit(EXIT_FAILURE);
+  }
+  for (int i = SERVER_MAX_MATCHES - 1; i >= 0; i--) {
+    sConnections[i].fd = -1;
+    sFreeConnections[sFreeCount++] = &sConnections[i];
+  }
+
+  // create the epoll instance and the server socket for each worker.
+  for (int i = 0; i < sWorkerCount; i++) {
+    Worker* worker = &sWorkers[i];
+    worker->index = i;
+    worker->connections = SDL_calloc(SERVER_MAX_MATCHES, sizeof(Connection*));
+    worker->inbox_lock = SDL_CreateMutex();
+    if (worker->connections == NULL || worker->inbox_lock == NULL) {
+      printf("Unable to allocate worker %d!\n", i);
+      exit(EXIT_FAILURE);
+    }
+    worker->epoll = epoll_create1(0);
+    if (worker->epoll < 0) {
+      perror("epoll_create1");
+      exit(EXIT_FAILURE);
+    }
+    open_socket(worker);
+  }
+  printf("Hosting up to %d matches on port %d with %d worker(s)...\n",
+    SERVER_MAX_MATCHES, NETWORK_PORT, sWorkerCount);
+
+  // start a thread for each worker.
+  SDL_AtomicSet(&sRunning, 1);
+  for (int i = 0; i < sWorkerCount; i++) {
+    sWorkers[i].thread = SDL_CreateThread(&worker_run, "worker", &sWorkers[i]);
+    if (sWorkers[i].thread == NULL) {
+      printf("SDL_CreateThread: %s\n", SDL_GetError());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // stop the server when the application is requested to quit.
+  while (SDL_AtomicGet(&sRunning) == 1) {
+    SDL_Event event;
+    while (SDL_PollEvent(&event) != 0) {
+      if (event.type == SDL_QUIT) {
+        SDL_AtomicSet(&sRunning, 0);
+      }
+    }
+
+    // publish the metrics with the amount of matches published by the workers.
+    int matches = 0;
+    for (int i = 0; i < sWorkerCount; i++) {
+      matches += SDL_AtomicGet(&sWorkers[i].published_count);
+    }
+    metrics_set(METRIC_MATCHES, matches);
+    metrics_poll();
+    SDL_Delay(TIMESTEP);
+  }
+
+  // close all matches and release the server resources.
+  for (int i = 0; i < sWorkerCount; i++) {
+    Worker* worker = &sWorkers[i];
+    SDL_WaitThread(worker->thread, NULL);
+    steal_adopt(worker);
+    while (worker->count > 0) {
+      connection_close(worker_detach(worker, worker->count - 1));
+    }
+    printf("Worker %d ran %d ticks with %d overrun(s) and %d stolen match(es).\n",
+      i, worker->ticks, worker->overruns, worker->stolen);
+    close(worker->socket);
+    close(worker->epoll);
+    SDL_DestroyMutex(worker->inbox_lock);
+    SDL_free(worker->connections);
+  }
+  SDL_DestroyMutex(sPoolLock);
+  SDL_free(sWorkers);
+  SDL_free(sFreeConnections);
+  SDL_free(sConnections);
+  sWorkers = NULL;
+  sFreeConnections = NULL;
+  sConnections = NULL;
+}
+
+#else
+
+void server_run(int transport, int workers)
+{
+  (void)transport;
+  (void)workers;
+  printf("The multi-match server requires the epoll API (Linux)!\n");
+  exit(EXIT_FAILURE);
+}
+
+#endif
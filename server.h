@@ -0,0 +1,14 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+// the maximum amount of concurrent matches hosted by a single server process.
+#define SERVER_MAX_MATCHES 1024
+// the maximum amount of worker threads used by a single server process.
+#define SERVER_MAX_WORKERS 64
+
+// run a server hosting a separate match for each connecting client until the
+// application is requested to quit. matches are sharded among the given amount
+// of worker threads (zero for one per core). requires the epoll API (Linux).
+void server_run(int transport, int workers);
+
+#endif
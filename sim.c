@@ -0,0 +1,220 @@
+#include "sim.h"
+#include "game.h"
+
+// the amount of steps to wait before each ball launch.
+#define SIM_COUNTDOWN_TICKS ((COUNTDOWN_MS + TIMESTEP - 1) / TIMESTEP)
+
+typedef struct {
+  // the fixed-point position of the box in x-axis.
+  Fixed x;
+  // the fixed-point position of the box in y-axis.
+  Fixed y;
+  // the fixed-point width of the box.
+  Fixed w;
+  // the fixed-point height of the box.
+  Fixed h;
+} Box;
+
+// ============================================================================
+// get a fixed-point box with the given position and pixel size.
+static Box box(Fixed x, Fixed y, int w, int h)
+{
+  Box result = { x, y, sim_fixed(w), sim_fixed(h) };
+  return result;
+}
+
+// ============================================================================
+// check whether the given boxes overlap (as SDL_HasIntersection).
+static int boxes_overlap(const Box* a, const Box* b)
+{
+  return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+// ============================================================================
+// check whether the box overlaps with the pixel rect.
+static int overlaps(const Box* a, const SDL_Rect* rect)
+{
+  Box b = box(sim_fixed(rect->x), sim_fixed(rect->y), rect->w, rect->h);
+  return boxes_overlap(a, &b);
+}
+
+// ============================================================================
+// get the next value of the deterministic random number generator (xorshift).
+static Uint32 next_random(SimState* state)
+{
+  Uint32 value = state->seed;
+  value ^= value << 13;
+  value ^= value >> 17;
+  value ^= value << 5;
+  state->seed = value;
+  return value;
+}
+
+// ============================================================================
+// move the paddle by the input direction within the walls.
+static Fixed move_paddle(Fixed x, Fixed y, int direction)
+{
+  if (direction == NONE) {
+    return y;
+  }
+
+  // ensure that the top and bottom wall boundaries are honoured.
+  y += sim_fixed(PADDLE_VELOCITY) * direction;
+  Box paddle = box(x, y, PADDLE_WIDTH, PADDLE_HEIGHT);
+  if (overlaps(&paddle, &TOP_WALL)) {
+    y = sim_fixed(TOP_WALL.y + TOP_WALL.h);
+  } else if (overlaps(&paddle, &BOTTOM_WALL)) {
+    y = sim_fixed(BOTTOM_WALL.y - PADDLE_HEIGHT);
+  }
+  return y;
+}
+
+// ============================================================================
+
+Fixed sim_fixed(int pixels)
+{
+  return (Fixed)pixels * SIM_FIXED_ONE;
+}
+
+// ============================================================================
+
+int sim_pixels(Fixed value)
+{
+  // avoid shifting negative values as its result is implementation-defined.
+  if (value >= 0) {
+    return value / SIM_FIXED_ONE;
+  }
+  return -((-value + SIM_FIXED_ONE - 1) / SIM_FIXED_ONE);
+}
+
+// ============================================================================
+
+int sim_pack_input(int direction)
+{
+  return (direction == UP ? 1 : direction == DOWN ? 2 : 0);
+}
+
+// ============================================================================
+
+int sim_unpack_input(int value)
+{
+  return (value == 1 ? UP : value == 2 ? DOWN : NONE);
+}
+
+// ============================================================================
+
+void sim_init(SimState* state, Uint32 seed)
+{
+  SDL_assert(state != NULL);
+
+  SDL_memset(state, 0, sizeof(SimState));
+  state->seed = (seed != 0 ? seed : 1);
+  sim_reset(state);
+}
+
+// ============================================================================
+
+void sim_reset(SimState* state)
+{
+  SDL_assert(state != NULL);
+
+  // reset dynamic objects back to their starting positions.
+  state->left_y = sim_fixed(LEFT_PADDLE_START.y);
+  state->right_y = sim_fixed(RIGHT_PADDLE_START.y);
+  state->ball_x = sim_fixed(BALL_START.x);
+  state->ball_y = sim_fixed(BALL_START.y);
+
+  // relaunch the ball after a countdown into a random direction.
+  state->ball_velocity = sim_fixed(BALL_INITIAL_VELOCITY);
+  state->launch_tick = state->tick + SIM_COUNTDOWN_TICKS;
+  state->ball_direction_x = ((next_random(state) & 1) == 0 ? LEFT : RIGHT);
+  state->ball_direction_y = ((next_random(state) & 1) == 0 ? UP : DOWN);
+}
+
+// ============================================================================
+
+int sim_move(const SimState* state, const SimInput* input, SimState* next)
+{
+  SDL_assert(state != NULL);
+  SDL_assert(input != NULL);
+  SDL_assert(next != NULL);
+
+  // read the launch countdown before writing the next state as the states may be the same.
+  int launched = (state->tick >= state->launch_tick);
+  *next = *state;
+  next->tick = state->tick + 1;
+  next->left_y = move_paddle(sim_fixed(LEFT_PADDLE_START.x), state->left_y, input->left);
+  next->right_y = move_paddle(sim_fixed(RIGHT_PADDLE_START.x), state->right_y, input->right);
+
+  // the ball stays still until it has been launched.
+  if (next->ball_velocity == 0 || launched == 0) {
+    return 0;
+  }
+
+  // move the ball based on the movement direction.
+  int events = 0;
+  next->ball_x += next->ball_velocity * next->ball_direction_x;
+  next->ball_y += next->ball_velocity * next->ball_direction_y;
+
+  // check whether the ball hits top or bottom walls.
+  Box ball = box(next->ball_x, next->ball_y, BALL_WIDTH, BALL_HEIGHT);
+  if (overlaps(&ball, &TOP_WALL)) {
+    next->ball_y = sim_fixed(TOP_WALL.y + TOP_WALL.h);
+    next->ball_direction_y *= -1;
+    events |= SIM_EVENT_WALL;
+  } else if (overlaps(&ball, &BOTTOM_WALL)) {
+    next->ball_y = sim_fixed(BOTTOM_WALL.y) - ball.h;
+    next->ball_direction_y *= -1;
+    events |= SIM_EVENT_WALL;
+  }
+
+  // check paddle collisions against the already moved paddles.
+  ball = box(next->ball_x, next->ball_y, BALL_WIDTH, BALL_HEIGHT);
+  Box left = box(sim_fixed(LEFT_PADDLE_START.x), next->left_y, PADDLE_WIDTH, PADDLE_HEIGHT);
+  Box right = box(sim_fixed(RIGHT_PADDLE_START.x), next->right_y, PADDLE_WIDTH, PADDLE_HEIGHT);
+  if (boxes_overlap(&ball, &left)) {
+    next->ball_x = left.x + left.w;
+    next->ball_direction_x *= -1;
+    next->ball_velocity += sim_fixed(BALL_VELOCITY_INCREMENT);
+    events |= SIM_EVENT_LEFT_PADDLE;
+  } else if (boxes_overlap(&ball, &right)) {
+    next->ball_x = right.x - ball.w;
+    next->ball_direction_x *= -1;
+    next->ball_velocity += sim_fixed(BALL_VELOCITY_INCREMENT);
+    events |= SIM_EVENT_RIGHT_PADDLE;
+  }
+
+  // check whether the ball hit either of the goals.
+  ball = box(next->ball_x, next->ball_y, BALL_WIDTH, BALL_HEIGHT);
+  if (overlaps(&ball, &LEFT_GOAL)) {
+    events |= SIM_EVENT_LEFT_GOAL;
+  } else if (overlaps(&ball, &RIGHT_GOAL)) {
+    events |= SIM_EVENT_RIGHT_GOAL;
+  }
+  return events;
+}
+
+// ============================================================================
+
+int sim_step(const SimState* state, const SimInput* input, SimState* next)
+{
+  int events = sim_move(state, input, next);
+  if ((events & (SIM_EVENT_LEFT_GOAL | SIM_EVENT_RIGHT_GOAL)) == 0) {
+    return events;
+  }
+
+  // give a point to the opponent of the player whose goal was hit.
+  if (events & SIM_EVENT_LEFT_GOAL) {
+    next->right_points++;
+  } else {
+    next->left_points++;
+  }
+
+  // reset the scene and stop the ball for good when the match has ended.
+  sim_reset(next);
+  if (next->left_points >= SCORE_LIMIT || next->right_points >= SCORE_LIMIT) {
+    next->ball_velocity = 0;
+    events |= SIM_EVENT_END;
+  }
+  return events;
+}
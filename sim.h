@@ -0,0 +1,83 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <SDL/SDL.h>
+
+// the amount of fractional bits in the fixed-point simulation values.
+#define SIM_FIXED_SHIFT 8
+// the fixed-point representation of a single pixel.
+#define SIM_FIXED_ONE (1 << SIM_FIXED_SHIFT)
+
+// available events produced by a single simulation step.
+enum SimEvent {
+  SIM_EVENT_WALL = 1,
+  SIM_EVENT_LEFT_PADDLE = 2,
+  SIM_EVENT_RIGHT_PADDLE = 4,
+  SIM_EVENT_LEFT_GOAL = 8,
+  SIM_EVENT_RIGHT_GOAL = 16,
+  SIM_EVENT_END = 32
+};
+
+// a sub-pixel fixed-point value with SIM_FIXED_SHIFT fractional bits.
+typedef Sint32 Fixed;
+
+// ============================================================================
+
+typedef struct {
+  // the amount of steps simulated so far.
+  Uint32 tick;
+  // the tick when the ball is launched after a reset.
+  Uint32 launch_tick;
+  // the state of the deterministic random number generator.
+  Uint32 seed;
+  // the vertical position of the left paddle.
+  Fixed left_y;
+  // the vertical position of the right paddle.
+  Fixed right_y;
+  // the horizontal position of the ball.
+  Fixed ball_x;
+  // the vertical position of the ball.
+  Fixed ball_y;
+  // the movement speed of the ball per step.
+  Fixed ball_velocity;
+  // the movement direction of the ball in x-axis.
+  Sint32 ball_direction_x;
+  // the movement direction of the ball in y-axis.
+  Sint32 ball_direction_y;
+  // the points of the left player.
+  Sint32 left_points;
+  // the points of the right player.
+  Sint32 right_points;
+} SimState;
+
+typedef struct {
+  // the movement direction (UP/DOWN/NONE) of the left paddle.
+  Sint32 left;
+  // the movement direction (UP/DOWN/NONE) of the right paddle.
+  Sint32 right;
+} SimInput;
+
+// ============================================================================
+
+// convert the given amount of pixels into a fixed-point value.
+Fixed sim_fixed(int pixels);
+// convert the given fixed-point value into pixels (rounded down).
+int sim_pixels(Fixed value);
+
+// pack the movement direction (UP/DOWN/NONE) into a two bit value.
+int sim_pack_input(int direction);
+// unpack the movement direction (UP/DOWN/NONE) from a two bit value.
+int sim_unpack_input(int value);
+
+// initialize the state into the beginning of a match with the given seed.
+void sim_init(SimState* state, Uint32 seed);
+// reset the paddles and the ball and pick a new ball direction.
+void sim_reset(SimState* state);
+// move the paddles and the ball by a single step without applying scoring.
+// returns the SimEvent flags of the step. the states may be the same object.
+int sim_move(const SimState* state, const SimInput* input, SimState* next);
+// simulate a single step with all rules of the game including scoring.
+// returns the SimEvent flags of the step. the states may be the same object.
+int sim_step(const SimState* state, const SimInput* input, SimState* next);
+
+#endif
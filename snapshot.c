@@ -0,0 +1,230 @@
+#include "snapshot.h"
+
+#include <limits.h>
+
+// the amount of delta encoded fields in a single state (all but the tick).
+#define FIELD_COUNT 11
+// the amount of bits used to describe the width of a changed field.
+#define WIDTH_BITS 5
+
+typedef struct {
+  // the buffer of the packed bits.
+  Uint8* data;
+  // the size of the buffer in bytes.
+  int size;
+  // the position of the next bit.
+  int position;
+} BitStream;
+
+// the interval (in ticks) between keyframes.
+static int sKeyframeInterval = SNAPSHOT_KEYFRAME_INTERVAL;
+
+// ============================================================================
+// get the delta encoded fields of the state.
+static void get_fields(const SimState* state, Uint32* fields)
+{
+  fields[0] = state->launch_tick;
+  fields[1] = state->seed;
+  fields[2] = (Uint32)state->left_y;
+  fields[3] = (Uint32)state->right_y;
+  fields[4] = (Uint32)state->ball_x;
+  fields[5] = (Uint32)state->ball_y;
+  fields[6] = (Uint32)state->ball_velocity;
+  fields[7] = (Uint32)state->ball_direction_x;
+  fields[8] = (Uint32)state->ball_direction_y;
+  fields[9] = (Uint32)state->left_points;
+  fields[10] = (Uint32)state->right_points;
+}
+
+// ============================================================================
+// set the delta encoded fields of the state.
+static void set_fields(SimState* state, const Uint32* fields)
+{
+  state->launch_tick = fields[0];
+  state->seed = fields[1];
+  state->left_y = (Fixed)fields[2];
+  state->right_y = (Fixed)fields[3];
+  state->ball_x = (Fixed)fields[4];
+  state->ball_y = (Fixed)fields[5];
+  state->ball_velocity = (Fixed)fields[6];
+  state->ball_direction_x = (Sint32)fields[7];
+  state->ball_direction_y = (Sint32)fields[8];
+  state->left_points = (Sint32)fields[9];
+  state->right_points = (Sint32)fields[10];
+}
+
+// ============================================================================
+// write the given amount of the lowest bits of the value.
+static int write_bits(BitStream* stream, Uint32 value, int bits)
+{
+  if (stream->position + bits > stream->size * 8) {
+    return -1;
+  }
+  for (int i = 0; i < bits; i++, stream->position++) {
+    Uint8 mask = (Uint8)(1 << (stream->position % 8));
+    if ((value >> i) & 1) {
+      stream->data[stream->position / 8] |= mask;
+    } else {
+      stream->data[stream->position / 8] &= (Uint8)~mask;
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+// read the given amount of bits into the lowest bits of the value.
+static int read_bits(BitStream* stream, Uint32* value, int bits)
+{
+  if (stream->position + bits > stream->size * 8) {
+    return -1;
+  }
+  *value = 0;
+  for (int i = 0; i < bits; i++, stream->position++) {
+    if ((stream->data[stream->position / 8] >> (stream->position % 8)) & 1) {
+      *value |= (Uint32)1 << i;
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+// get the amount of bits required to represent the value.
+static int bit_width(Uint32 value)
+{
+  int bits = 0;
+  while (value != 0) {
+    value >>= 1;
+    bits++;
+  }
+  return bits;
+}
+
+// ============================================================================
+
+void snapshot_set_keyframe_interval(int interval)
+{
+  SDL_assert(interval >= 0);
+  sKeyframeInterval = interval;
+}
+
+// ============================================================================
+
+int snapshot_get_keyframe_interval()
+{
+  return sKeyframeInterval;
+}
+
+// ============================================================================
+
+void snapshot_init(Snapshots* snapshots)
+{
+  SDL_assert(snapshots != NULL);
+
+  SDL_memset(snapshots, 0, sizeof(Snapshots));
+  snapshots->acked = -1;
+  snapshots->keyframe = INT_MIN / 2;
+  for (int i = 0; i < SNAPSHOT_HISTORY; i++) {
+    snapshots->states[i].tick = (Uint32)-1;
+  }
+}
+
+// ============================================================================
+
+void snapshot_store(Snapshots* snapshots, const SimState* state)
+{
+  SDL_assert(snapshots != NULL);
+  SDL_assert(state != NULL);
+  snapshots->states[state->tick % SNAPSHOT_HISTORY] = *state;
+}
+
+// ============================================================================
+
+const SimState* snapshot_find(const Snapshots* snapshots, int tick)
+{
+  SDL_assert(snapshots != NULL);
+  if (tick < 0) {
+    return NULL;
+  }
+  const SimState* state = &snapshots->states[tick % SNAPSHOT_HISTORY];
+  return (state->tick == (Uint32)tick ? state : NULL);
+}
+
+// ============================================================================
+
+int snapshot_keyframe_due(Snapshots* snapshots, int tick)
+{
+  SDL_assert(snapshots != NULL);
+  if (sKeyframeInterval > 0 && tick - snapshots->keyframe >= sKeyframeInterval) {
+    snapshots->keyframe = tick;
+    return 1;
+  }
+  return 0;
+}
+
+// ============================================================================
+
+int snapshot_encode(const SimState* base, const SimState* state, Uint8* buffer, int size)
+{
+  SDL_assert(state != NULL);
+  SDL_assert(buffer != NULL);
+
+  // a keyframe is a delta against a state with all fields zeroed.
+  Uint32 from[FIELD_COUNT] = { 0 };
+  Uint32 to[FIELD_COUNT];
+  if (base != NULL) {
+    get_fields(base, from);
+  }
+  get_fields(state, to);
+
+  // write a change bit for each field and the width and zigzag value of changes.
+  BitStream stream = { buffer, size, 0 };
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    Sint32 delta = (Sint32)(to[i] - from[i]);
+    Uint32 zigzag = ((Uint32)delta << 1) ^ (Uint32)(delta < 0 ? -1 : 0);
+    int width = bit_width(zigzag);
+    if (write_bits(&stream, (width > 0 ? 1 : 0), 1) < 0) {
+      return -1;
+    }
+    if (width > 0) {
+      if (write_bits(&stream, (Uint32)(width - 1), WIDTH_BITS) < 0
+        || write_bits(&stream, zigzag, width) < 0) {
+        return -1;
+      }
+    }
+  }
+  return (stream.position + 7) / 8;
+}
+
+// ============================================================================
+
+int snapshot_decode(const SimState* base, const Uint8* data, int size, SimState* state)
+{
+  SDL_assert(data != NULL);
+  SDL_assert(state != NULL);
+
+  Uint32 fields[FIELD_COUNT] = { 0 };
+  if (base != NULL) {
+    get_fields(base, fields);
+  }
+
+  // apply the changed fields on top of the base fields.
+  BitStream stream = { (Uint8*)data, size, 0 };
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    Uint32 changed = 0;
+    if (read_bits(&stream, &changed, 1) < 0) {
+      return -1;
+    }
+    if (changed == 1) {
+      Uint32 width = 0;
+      Uint32 zigzag = 0;
+      if (read_bits(&stream, &width, WIDTH_BITS) < 0
+        || read_bits(&stream, &zigzag, (int)width + 1) < 0) {
+        return -1;
+      }
+      Uint32 delta = (zigzag >> 1) ^ (Uint32)-(Sint32)(zigzag & 1);
+      fields[i] += delta;
+    }
+  }
+  set_fields(state, fields);
+  return 0;
+}
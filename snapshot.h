@@ -0,0 +1,49 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "sim.h"
+
+// the amount of sent (server) or received (client) states kept as delta baselines.
+#define SNAPSHOT_HISTORY 64
+// the default interval (in ticks) between full keyframes.
+#define SNAPSHOT_KEYFRAME_INTERVAL 60
+
+typedef struct {
+  // the stored states indexed by their simulation tick.
+  SimState states[SNAPSHOT_HISTORY];
+  // the newest tick acknowledged by the client (server) or received (client). -1 for none.
+  int acked;
+  // the tick of the most recent keyframe.
+  int keyframe;
+  // the amount of keyframes sent or received.
+  int keyframes;
+  // the amount of deltas sent or received.
+  int deltas;
+  // the total amount of packed bytes sent or received.
+  int bytes;
+} Snapshots;
+
+// ============================================================================
+
+// select the interval (in ticks) between keyframes. zero sends them only on demand.
+void snapshot_set_keyframe_interval(int interval);
+// get the interval (in ticks) between keyframes.
+int snapshot_get_keyframe_interval();
+
+// initialize the snapshots to contain no states.
+void snapshot_init(Snapshots* snapshots);
+// store the state as a baseline for the deltas.
+void snapshot_store(Snapshots* snapshots, const SimState* state);
+// find the stored state of the given tick or NULL when it's not available.
+const SimState* snapshot_find(const Snapshots* snapshots, int tick);
+// check whether a periodic keyframe should be sent at the given tick and mark it sent.
+int snapshot_keyframe_due(Snapshots* snapshots, int tick);
+
+// pack the state as a delta against the base (NULL for a keyframe) into the buffer.
+// returns the amount of written bytes (the tick is not included) or -1 when it does not fit.
+int snapshot_encode(const SimState* base, const SimState* state, Uint8* buffer, int size);
+// unpack the state from a delta against the base (NULL for a keyframe).
+// returns -1 when the data is malformed and zero otherwise.
+int snapshot_decode(const SimState* base, const Uint8* data, int size, SimState* state);
+
+#endif
@@ -0,0 +1,470 @@
+#include <SDL/SDL.h>
+
+#include "game.h"
+#include "history.h"
+#include "protocol.h"
+#include "ring.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the minimum measured time (ms) of a single benchmark repetition.
+#define BENCH_MIN_TIME_MS 20
+// the amount of repetitions of which the fastest one is reported.
+#define BENCH_REPEATS 5
+// the maximum amount of benchmark results.
+#define BENCH_MAX_RESULTS 128
+// the maximum length of a benchmark name.
+#define BENCH_MAX_NAME 64
+// the default allowed slowdown (percent) against the baseline.
+#define BENCH_DEFAULT_THRESHOLD 20
+// the amount of messages in the framed TCP stream benchmark.
+#define BENCH_STREAM_MESSAGES 64
+// the size of the encoded TCP stream benchmark data.
+#define BENCH_STREAM_SIZE (BENCH_STREAM_MESSAGES * PROTOCOL_MAX_MESSAGE_SIZE)
+
+// a function pointer type for a benchmark body run the given amount of times.
+typedef void (*bench_func)(int iterations);
+
+typedef struct {
+  // the unique name of the benchmark.
+  char name[BENCH_MAX_NAME];
+  // the amount of measured iterations.
+  int iterations;
+  // the average time of a single iteration in nanoseconds.
+  double ns;
+} BenchResult;
+
+// the history depths used with the state benchmarks.
+static const int HISTORY_DEPTHS[] = { HISTORY_MIN_DEPTH, 32, HISTORY_MAX_DEPTH };
+
+// the chunk sizes used to fragment the TCP stream benchmark data.
+static const int STREAM_CHUNKS[] = { 1, 7, 64, NETWORK_BUFFER_SIZE };
+
+// the measured benchmark results.
+static BenchResult sResults[BENCH_MAX_RESULTS];
+// the amount of measured benchmark results.
+static int sResultCount = 0;
+// a sink for the benchmark outputs to keep them from being optimized away (wraps around).
+static volatile Uint32 sSink = 0;
+
+// the match used by the state and update benchmarks.
+static Match sMatch;
+// the history depth used by the state benchmarks.
+static int sDepth = 0;
+// the time of the next state added by the state set benchmark (kept across its calls).
+static int sNextTime = 0;
+// the message used by the protocol benchmarks.
+static Message sMessage;
+// the encoded message used by the protocol decoding benchmarks.
+static Uint8 sEncoded[PROTOCOL_MAX_MESSAGE_SIZE];
+// the size of the encoded message.
+static int sEncodedSize = 0;
+// the encoded message stream used by the TCP framing benchmarks.
+static Uint8 sStream[BENCH_STREAM_SIZE];
+// the size of the encoded message stream.
+static int sStreamSize = 0;
+// the chunk size used to fragment the message stream.
+static int sChunk = 0;
+
+// ============================================================================
+// discard the messages sent by the benchmarked match.
+static void discard_send(Match* match, const Message* msg)
+{
+  (void)match;
+  sSink += msg->type;
+}
+
+// ============================================================================
+// measure the benchmark body with an increasing amount of iterations.
+static void measure(const char* name, bench_func func)
+{
+  SDL_assert(sResultCount < BENCH_MAX_RESULTS);
+
+  // double the iterations until the measurement is long enough to be stable.
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  Uint64 elapsed = 0;
+  int iterations = 1;
+  for (;;) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    func(iterations);
+    elapsed = SDL_GetPerformanceCounter() - start;
+    if (elapsed * 1000 >= frequency * BENCH_MIN_TIME_MS || iterations >= (1 << 28)) {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  // keep the fastest repetition as the others are only slowed down by noise.
+  for (int i = 1; i < BENCH_REPEATS; i++) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    func(iterations);
+    elapsed = SDL_min(elapsed, SDL_GetPerformanceCounter() - start);
+  }
+
+  BenchResult* result = &sResults[sResultCount++];
+  SDL_snprintf(result->name, BENCH_MAX_NAME, "%s", name);
+  result->iterations = iterations;
+  result->ns = (double)elapsed * 1000000000.0 / frequency / iterations;
+  fprintf(stderr, "%-40s %12.1f ns\n", result->name, result->ns);
+}
+
+// ============================================================================
+// fill the history of the remote paddle with one state per tick.
+static void fill_history(int depth)
+{
+  match_init(&sMatch, SERVER, &discard_send, NULL);
+  history_set_depth(&sMatch.right_paddle.history, depth);
+  SDL_Rect rect = RIGHT_PADDLE_START;
+  for (int i = 1; i <= depth; i++) {
+    rect.y = (rect.y + PADDLE_VELOCITY) % RESOLUTION_HEIGHT;
+    state_set(&sMatch.right_paddle, &rect, i * TIMESTEP);
+  }
+  sNextTime = (depth + 1) * TIMESTEP;
+}
+
+// ============================================================================
+// get interpolated remote paddle states at times spread over the history.
+static void bench_state_get(int iterations)
+{
+  int span = sDepth * TIMESTEP;
+  int offset = 0;
+  for (int i = 0; i < iterations; i++) {
+    offset = (offset + 7919) % span;
+    sSink += state_get(&sMatch, &sMatch.right_paddle, TIMESTEP + offset).y;
+  }
+}
+
+// ============================================================================
+// add remote paddle states with increasing timestamps into a full history.
+static void bench_state_set(int iterations)
+{
+  // each repeated call continues after the newest state so every state is a real append.
+  if (iterations > (SDL_MAX_SINT32 - sNextTime) / TIMESTEP) {
+    fill_history(sDepth);
+  }
+  SDL_Rect rect = RIGHT_PADDLE_START;
+  for (int i = 0; i < iterations; i++, sNextTime += TIMESTEP) {
+    rect.y = i % RESOLUTION_HEIGHT;
+    state_set(&sMatch.right_paddle, &rect, sNextTime);
+  }
+}
+
+// ============================================================================
+// replace the newest half of the remote paddle states.
+static void bench_state_clear(int iterations)
+{
+  static History full;
+  History* history = &sMatch.right_paddle.history;
+  full = *history;
+  int from = SDL_max(1, history_newest(history)->time - (sDepth / 2) * TIMESTEP);
+  for (int i = 0; i < iterations; i++) {
+    state_clear(&sMatch.right_paddle, &RIGHT_PADDLE_START, from);
+
+    // clearing only shortens the ring and writes the replacing state into a single slot,
+    // so restoring those brings back the full history for the next iteration.
+    int slot = (history->head + history->count - 1) % HISTORY_MAX_DEPTH;
+    history->states[slot] = full.states[slot];
+    history->count = full.count;
+  }
+}
+
+// ============================================================================
+// encode the benchmarked message.
+static void bench_encode(int iterations)
+{
+  Uint8 buffer[PROTOCOL_MAX_MESSAGE_SIZE];
+  for (int i = 0; i < iterations; i++) {
+    sSink += protocol_encode(&sMessage, buffer, PROTOCOL_MAX_MESSAGE_SIZE);
+  }
+}
+
+// ============================================================================
+// decode the benchmarked message.
+static void bench_decode(int iterations)
+{
+  Message msg;
+  for (int i = 0; i < iterations; i++) {
+    sSink += protocol_decode(sEncoded, sEncodedSize, &msg);
+  }
+}
+
+// ============================================================================
+// feed the message stream into a ring buffer in chunks and decode all messages.
+static void bench_stream(int iterations)
+{
+  static RingBuffer ring;
+  Message msg;
+  for (int i = 0; i < iterations; i++) {
+    ring_clear(&ring);
+    int offset = 0;
+    while (offset < sStreamSize) {
+      Uint8* data = NULL;
+      int space = ring_reserve(&ring, &data);
+      int bytes = SDL_min(SDL_min(sChunk, sStreamSize - offset), space);
+      SDL_memcpy(data, sStream + offset, bytes);
+      ring_commit(&ring, bytes);
+      offset += bytes;
+      while (ring_next_message(&ring, &msg) > 0) {
+        sSink += msg.type;
+      }
+    }
+  }
+}
+
+// ============================================================================
+// start a new benchmarked match with the ball already launched.
+static void start_update_match()
+{
+  match_init(&sMatch, SERVER, &discard_send, NULL);
+  match_start(&sMatch);
+  sMatch.countdown = 0;
+  sMatch.prediction.state.launch_tick = sMatch.prediction.state.tick;
+}
+
+// ============================================================================
+// run ticks of the started match while alternating the paddle movement.
+static void bench_update(int iterations)
+{
+  for (int i = 0; i < iterations; i++) {
+    // restart on the first point to keep measuring rallies instead of countdowns.
+    if (sMatch.left_points + sMatch.right_points > 0 || sMatch.state != RUNNING) {
+      start_update_match();
+    }
+    int time = sMatch.previous_tick + TIMESTEP;
+    sMatch.left_paddle.direction_y = ((i / 30) % 2 == 0 ? UP : DOWN);
+    match_update(&sMatch, time);
+    sMatch.previous_tick = time;
+  }
+}
+
+// ============================================================================
+// record empty traced scopes.
+static void bench_trace(int iterations)
+{
+  for (int i = 0; i < iterations; i++) {
+    Uint64 traced = trace_begin();
+    sSink += i;
+    trace_end("bench", "scope", traced);
+  }
+}
+
+// ============================================================================
+// build a message of the given type with representative field values.
+static Message sample_message(int type)
+{
+  Message msg;
+  SDL_memset(&msg, 0, sizeof(msg));
+  msg.type = type;
+  switch (type) {
+    case MESSAGE_PING:
+      msg.ping = (PingMessage) { 123456 };
+      break;
+    case MESSAGE_PONG:
+      msg.pong = (PongMessage) { 123456, 654321 };
+      break;
+    case MESSAGE_LEFT:
+    case MESSAGE_RIGHT:
+      msg.paddle = (PaddleMessage) { 123456, PADDLE_EDGE_OFFSET, RESOLUTION_HALF_HEIGHT };
+      break;
+    case MESSAGE_BALL:
+      msg.ball = (BallMessage) { 123456, 377, 211, -1, 1, BALL_INITIAL_VELOCITY + 3 };
+      break;
+    case MESSAGE_RESET:
+      msg.reset = (ResetMessage) { 123456, 125456, 1, -1, 4, 7 };
+      break;
+    case MESSAGE_START:
+      msg.start = (StartMessage) { 123456, 987654321 };
+      break;
+    case MESSAGE_INPUT:
+      msg.input = (InputMessage) { 7262, 0x5a5a5a, 7250 };
+      break;
+    case MESSAGE_SNAPSHOT:
+      msg.snapshot.ack = 7262;
+      msg.snapshot.input = 1;
+      msg.snapshot.tick = 7270;
+      msg.snapshot.base = 3;
+      msg.snapshot.length = 6;
+      for (int i = 0; i < msg.snapshot.length; i++) {
+        msg.snapshot.data[i] = (Uint8)(i * 37 + 11);
+      }
+      break;
+  }
+  return msg;
+}
+
+// ============================================================================
+// run the state benchmarks with each history depth.
+static void run_state_benches()
+{
+  char name[BENCH_MAX_NAME];
+  for (unsigned i = 0; i < SDL_arraysize(HISTORY_DEPTHS); i++) {
+    sDepth = HISTORY_DEPTHS[i];
+    fill_history(sDepth);
+    SDL_snprintf(name, BENCH_MAX_NAME, "state_get/depth=%d", sDepth);
+    measure(name, &bench_state_get);
+    fill_history(sDepth);
+    SDL_snprintf(name, BENCH_MAX_NAME, "state_set/depth=%d", sDepth);
+    measure(name, &bench_state_set);
+    fill_history(sDepth);
+    SDL_snprintf(name, BENCH_MAX_NAME, "state_clear/depth=%d", sDepth);
+    measure(name, &bench_state_clear);
+  }
+}
+
+// ============================================================================
+// run the encoding, decoding and stream framing benchmarks with each format.
+static void run_protocol_benches()
+{
+  char name[BENCH_MAX_NAME];
+  for (int format = BINARY; format <= TEXT; format++) {
+    protocol_set_format(format);
+    const char* formatName = (format == BINARY ? "binary" : "text");
+    for (int type = 0; type < MESSAGE_TYPE_COUNT; type++) {
+      sMessage = sample_message(type);
+      sEncodedSize = protocol_encode(&sMessage, sEncoded, PROTOCOL_MAX_MESSAGE_SIZE);
+      SDL_snprintf(name, BENCH_MAX_NAME, "encode/%s/%s", formatName, protocol_get_name(type));
+      measure(name, &bench_encode);
+      SDL_snprintf(name, BENCH_MAX_NAME, "decode/%s/%s", formatName, protocol_get_name(type));
+      measure(name, &bench_decode);
+    }
+
+    // frame a stream of mixed messages delivered in fragments of various sizes.
+    sStreamSize = 0;
+    for (int i = 0; i < BENCH_STREAM_MESSAGES; i++) {
+      Message msg = sample_message(MESSAGE_PING + i % (MESSAGE_TYPE_COUNT - MESSAGE_PING));
+      sStreamSize += protocol_encode(&msg, sStream + sStreamSize, BENCH_STREAM_SIZE - sStreamSize);
+    }
+    for (unsigned i = 0; i < SDL_arraysize(STREAM_CHUNKS); i++) {
+      sChunk = STREAM_CHUNKS[i];
+      SDL_snprintf(name, BENCH_MAX_NAME, "stream/%s/chunk=%d", formatName, sChunk);
+      measure(name, &bench_stream);
+    }
+  }
+  protocol_set_format(BINARY);
+}
+
+// ============================================================================
+// run the per tick update benchmarks with each simulating netcode.
+static void run_update_benches()
+{
+  static const int NETCODES[] = { NETCODE_LAG, NETCODE_PREDICT };
+  static const char* NETCODE_NAMES[] = { "lag", "predict" };
+  char name[BENCH_MAX_NAME];
+  for (unsigned i = 0; i < SDL_arraysize(NETCODES); i++) {
+    match_set_netcode(NETCODES[i]);
+    start_update_match();
+    SDL_snprintf(name, BENCH_MAX_NAME, "update/%s", NETCODE_NAMES[i]);
+    measure(name, &bench_update);
+  }
+  match_set_netcode(NETCODE_LAG);
+}
+
+// ============================================================================
+// run the traced scope benchmarks with the tracing disabled and enabled.
+static void run_trace_benches()
+{
+  measure("trace/disabled", &bench_trace);
+  trace_set_file("bench-trace.json");
+  measure("trace/enabled", &bench_trace);
+  trace_set_file(NULL);
+}
+
+// ============================================================================
+// write the results as JSON into the given stream.
+static void write_results(FILE* out)
+{
+  fprintf(out, "{\n  \"benchmarks\": [\n");
+  for (int i = 0; i < sResultCount; i++) {
+    fprintf(out, "    { \"name\": \"%s\", \"iterations\": %d, \"ns_per_op\": %.3f }%s\n",
+      sResults[i].name, sResults[i].iterations, sResults[i].ns,
+      (i + 1 < sResultCount ? "," : ""));
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+// ============================================================================
+// compare the results with a baseline written earlier by this tool.
+// returns the amount of benchmarks slower than the baseline by over the threshold.
+static int compare_baseline(const char* path, int threshold)
+{
+  FILE* in = fopen(path, "r");
+  if (in == NULL) {
+    printf("Unable to open the baseline %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+
+  // each baseline result is on its own line as written by write_results.
+  int regressions = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    char name[BENCH_MAX_NAME];
+    int iterations = 0;
+    double ns = 0.0;
+    if (sscanf(line, " { \"name\": \"%63[^\"]\", \"iterations\": %d, \"ns_per_op\": %lf",
+      name, &iterations, &ns) != 3) {
+      continue;
+    }
+    for (int i = 0; i < sResultCount; i++) {
+      if (strcmp(sResults[i].name, name) != 0 || ns <= 0.0) {
+        continue;
+      }
+      double change = (sResults[i].ns - ns) * 100.0 / ns;
+      int regressed = (change > threshold ? 1 : 0);
+      regressions += regressed;
+      fprintf(stderr, "%-40s %12.1f ns -> %12.1f ns %+7.1f%%%s\n",
+        name, ns, sResults[i].ns, change, (regressed == 1 ? " REGRESSION" : ""));
+    }
+  }
+  fclose(in);
+  return regressions;
+}
+
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+  const char* output = NULL;
+  const char* baseline = NULL;
+  int threshold = BENCH_DEFAULT_THRESHOLD;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--output=", 9) == 0) {
+      output = argv[i] + 9;
+    } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+      baseline = argv[i] + 11;
+    } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+      threshold = SDL_max(0, atoi(argv[i] + 12));
+    } else {
+      printf("Usage: %s [--output=FILE] [--baseline=FILE] [--threshold=PERCENT]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  run_state_benches();
+  run_protocol_benches();
+  run_update_benches();
+  run_trace_benches();
+
+  // write the results into the output file or the standard output.
+  FILE* out = (output == NULL ? stdout : fopen(output, "w"));
+  if (out == NULL) {
+    printf("Unable to open the output %s\n", output);
+    return EXIT_FAILURE;
+  }
+  write_results(out);
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  // fail when any benchmark has regressed against the baseline.
+  if (baseline != NULL) {
+    int regressions = compare_baseline(baseline, threshold);
+    if (regressions > 0) {
+      fprintf(stderr, "%d benchmark(s) regressed over %d%%\n", regressions, threshold);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,559 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <SDL/SDL.h>
+
+#include "bot.h"
+#include "channel.h"
+#include "game.h"
+#include "ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// the maximum amount of concurrent bot clients.
+#define LOADGEN_MAX_CLIENTS 16384
+// the maximum amount of events to handle with a single epoll wait.
+#define LOADGEN_MAX_EVENTS 256
+// the size of the outgoing message buffer for each client.
+#define LOADGEN_OUTPUT_SIZE 4096
+// the amount of milliseconds without any data until a client is considered failed.
+#define LOADGEN_TIMEOUT_MS 5000
+// the amount of one millisecond buckets in the round-trip time histogram.
+#define LOADGEN_RTT_BUCKETS 1000
+// the amount of ticks without server data after which a simulating client has stalled.
+#define LOADGEN_STALL_TICKS 3
+// the interval (ms) between the progress reports.
+#define LOADGEN_REPORT_INTERVAL 1000
+
+typedef struct {
+  // a definition whether the client slot is in use.
+  int used;
+  // the socket connected to the server.
+  int fd;
+  // the time when data was last received from the server.
+  int last_receive_ticks;
+  // a definition whether the current gap in the server data has been counted as a stall.
+  int stalled;
+  // the match played by the client.
+  Match match;
+  // the bot controlling the paddle of the client.
+  Bot bot;
+  // the reliable channel used to deliver the control messages over UDP.
+  Channel channel;
+  // the ring buffer for incoming TCP stream data.
+  RingBuffer input;
+  // the buffer for outgoing messages batched during a tick.
+  Uint8 output[LOADGEN_OUTPUT_SIZE];
+  // the amount of batched bytes in the outgoing buffer.
+  int output_size;
+} Client;
+
+typedef struct {
+  // the amount of started matches.
+  int started;
+  // the amount of matches played until the score limit.
+  int completed;
+  // the amount of matches which ended early (drops, timeouts and errors).
+  int failed;
+  // the amount of sent messages.
+  int sent;
+  // the amount of received messages.
+  int received;
+  // the amount of sent bytes.
+  Sint64 sent_bytes;
+  // the amount of received bytes.
+  Sint64 received_bytes;
+  // the amount of ticks run by the load generator.
+  int ticks;
+  // the amount of ticks which missed their deadline.
+  int overruns;
+  // the amount of gaps in the server data of simulating clients.
+  int stalls;
+  // the amount of round-trip time samples.
+  int rtt_count;
+  // the round-trip time samples in one millisecond buckets.
+  int rtt[LOADGEN_RTT_BUCKETS];
+} LoadStats;
+
+// ============================================================================
+
+// the network transport mode (TCP/UDP) of the clients.
+static int sTransport = TCP;
+// the address of the server.
+static struct sockaddr_in sAddress;
+// the amount of concurrent bot clients.
+static int sClientCount = 100;
+// the amount of new clients connected per second during the ramp-up.
+static int sRate = 100;
+// the duration (seconds) of the load test.
+static int sDuration = 30;
+// the reaction delay (ms) of the bots.
+static int sBotReaction = BOT_DEFAULT_REACTION;
+// the maximum aiming error (pixels) of the bots.
+static int sBotError = BOT_DEFAULT_ERROR;
+// the epoll instance used to listen for socket activities.
+static int sEpoll = -1;
+// the client slots.
+static Client* sClients = NULL;
+// the amount of opened clients during the ramp-up.
+static int sOpened = 0;
+// the statistics of the whole load test.
+static LoadStats sStats;
+
+// ============================================================================
+// send all batched messages of the client to the server.
+static void client_flush(Client* client)
+{
+  // acks and retransmissions are sent even without any new UDP messages.
+  int now = SDL_GetTicks();
+  if (client->output_size == 0
+    && (sTransport == TCP || channel_has_output(&client->channel, now) == 0)) {
+    return;
+  }
+
+  if (sTransport == UDP) {
+    // a UDP batch is always sent as a single packet with the channel header.
+    Uint8 packet[NETWORK_MTU];
+    int size = client->output_size;
+    int length = channel_write(&client->channel, packet, NETWORK_MTU - size, now);
+    memcpy(packet + length, client->output, size);
+    if (send(client->fd, packet, length + size, 0) > 0) {
+      sStats.sent_bytes += length + size;
+    }
+    client->output_size = 0;
+    return;
+  }
+
+  // send as much as the socket accepts and keep the rest (also while connecting).
+  ssize_t sent = send(client->fd, client->output, client->output_size, MSG_NOSIGNAL);
+  if (sent < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOTCONN) {
+      client->match.state = STOPPED;
+    }
+    return;
+  }
+  memmove(client->output, client->output + sent, client->output_size - sent);
+  client->output_size -= (int)sent;
+  sStats.sent_bytes += sent;
+}
+
+// ============================================================================
+// batch the given message to be sent to the server of the match.
+static void client_send(Match* match, const Message* msg)
+{
+  SDL_assert(match != NULL);
+  SDL_assert(msg != NULL);
+
+  // control messages are queued into the reliable channel with UDP.
+  Client* client = match->connection;
+  sStats.sent++;
+  if (sTransport == UDP && channel_is_reliable(msg->type) == 1) {
+    if (channel_queue(&client->channel, msg) < 0) {
+      match->state = STOPPED;
+    }
+    return;
+  }
+
+  // split the batch at the MTU with UDP and at the buffer size with TCP.
+  int limit = (sTransport == UDP ? NETWORK_MTU - CHANNEL_RESERVED_SIZE : LOADGEN_OUTPUT_SIZE);
+  int size = protocol_encode(msg, client->output + client->output_size, limit - client->output_size);
+  if (size == 0) {
+    client_flush(client);
+    size = protocol_encode(msg, client->output + client->output_size, limit - client->output_size);
+  }
+  if (size == 0) {
+    match->state = STOPPED;
+    return;
+  }
+  client->output_size += size;
+}
+
+// ============================================================================
+// record the statistics of the received message and dispatch it to the match.
+static void client_dispatch(Client* client, const Message* msg)
+{
+  int now = SDL_GetTicks();
+  sStats.received++;
+  client->last_receive_ticks = now;
+  client->stalled = 0;
+
+  // pings carry the local send time, so the pong tells the raw round-trip time.
+  if (msg->type == MESSAGE_PONG) {
+    int rtt = now - msg->pong.ping;
+    sStats.rtt[SDL_max(0, SDL_min(rtt, LOADGEN_RTT_BUCKETS - 1))]++;
+    sStats.rtt_count++;
+  }
+  match_dispatch(&client->match, msg);
+}
+
+// ============================================================================
+// receive and dispatch all pending data from the server.
+static void client_read(Client* client)
+{
+  for (;;) {
+    Uint8 buffer[NETWORK_BUFFER_SIZE];
+    Uint8* space = buffer;
+    int capacity = NETWORK_BUFFER_SIZE;
+    if (sTransport == TCP) {
+      capacity = ring_reserve(&client->input, &space);
+    }
+    ssize_t bytes = recv(client->fd, space, capacity, 0);
+    if (bytes == 0 && sTransport == TCP) {
+      client->match.state = STOPPED;
+      return;
+    } else if (bytes < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        client->match.state = STOPPED;
+      }
+      return;
+    }
+    sStats.received_bytes += bytes;
+
+    Message msg;
+    if (sTransport == TCP) {
+      // process all complete messages from the received data stream.
+      ring_commit(&client->input, (int)bytes);
+      int result = 0;
+      while ((result = ring_next_message(&client->input, &msg)) > 0) {
+        client_dispatch(client, &msg);
+      }
+      if (result < 0) {
+        client->match.state = STOPPED;
+        return;
+      }
+      continue;
+    }
+
+    // skip duplicated, too old and malformed packets.
+    int offset = channel_read(&client->channel, buffer, (int)bytes, SDL_GetTicks());
+    if (offset < 0) {
+      continue;
+    }
+    while (channel_next(&client->channel, &msg) == 1) {
+      client_dispatch(client, &msg);
+    }
+    while (offset < bytes) {
+      int size = protocol_decode(buffer + offset, (int)bytes - offset, &msg);
+      if (size <= 0) {
+        break;
+      }
+      offset += size;
+      client_dispatch(client, &msg);
+    }
+  }
+}
+
+// ============================================================================
+// connect a new bot client to the server and start its match.
+static void client_open(Client* client, Uint32 seed)
+{
+  int fd = socket(AF_INET, (sTransport == TCP ? SOCK_STREAM : SOCK_DGRAM) | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    perror("socket");
+    sStats.failed++;
+    return;
+  }
+  if (sTransport == TCP) {
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+
+  // a connected UDP socket only receives the packets of the server.
+  if (connect(fd, (struct sockaddr*)&sAddress, sizeof(sAddress)) != 0 && errno != EINPROGRESS) {
+    perror("connect");
+    close(fd);
+    sStats.failed++;
+    return;
+  }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = client;
+  if (epoll_ctl(sEpoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+    perror("epoll_ctl");
+    close(fd);
+    sStats.failed++;
+    return;
+  }
+
+  client->used = 1;
+  client->fd = fd;
+  client->last_receive_ticks = SDL_GetTicks();
+  client->stalled = 0;
+  client->output_size = 0;
+  ring_clear(&client->input);
+  channel_init(&client->channel);
+  match_init(&client->match, CLIENT, &client_send, client);
+  bot_init(&client->bot, sBotReaction, sBotError, seed);
+  sStats.started++;
+
+  // the hello message makes the UDP server start a match for the new address.
+  if (sTransport == UDP) {
+    Message msg = { .type = MESSAGE_HELLO };
+    client_send(&client->match, &msg);
+  }
+  match_start(&client->match);
+  client_flush(client);
+}
+
+// ============================================================================
+// disconnect the client and record whether its match was played to the end.
+static void client_close(Client* client)
+{
+  SDL_assert(client->used == 1);
+
+  Match* match = &client->match;
+  if (match->left_points >= SCORE_LIMIT || match->right_points >= SCORE_LIMIT) {
+    sStats.completed++;
+  } else {
+    sStats.failed++;
+  }
+  if (sTransport == UDP) {
+    // inform the server with a single attempt as the slot is released right away.
+    Message msg = { .type = MESSAGE_QUIT };
+    client_send(match, &msg);
+    client_flush(client);
+  }
+  epoll_ctl(sEpoll, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  client->used = 0;
+  client->fd = -1;
+}
+
+// ============================================================================
+// update all matches with a single fixed timestep and replace the ended ones.
+static void tick()
+{
+  int ticks = SDL_GetTicks();
+  for (int i = 0; i < sOpened; i++) {
+    Client* client = &sClients[i];
+    if (client->used == 0) {
+      client_open(client, (Uint32)(sStats.started + 1) * 2654435761u);
+      continue;
+    }
+
+    // count the gaps of the per tick server data of the simulating netcodes.
+    Match* match = &client->match;
+    int silence = ticks - client->last_receive_ticks;
+    if (client->stalled == 0 && silence > LOADGEN_STALL_TICKS * TIMESTEP
+      && (match->prediction.enabled == 1 || match->rollback.enabled == 1)) {
+      client->stalled = 1;
+      sStats.stalls++;
+    }
+    if (silence > LOADGEN_TIMEOUT_MS) {
+      match->state = STOPPED;
+    }
+
+    if (match->state == RUNNING) {
+      DynamicObject* paddle = &match->right_paddle;
+      paddle->direction_y = bot_input(&client->bot, match, paddle, match_ticks(match));
+      match_poll(match);
+    }
+    if (match->state == RUNNING) {
+      int time = match_ticks(match);
+      match_update(match, time);
+      match->previous_tick = time;
+      client_flush(client);
+    }
+    if (match->state != RUNNING) {
+      client_close(client);
+    }
+  }
+}
+
+// ============================================================================
+// print the progress of the load test since the previous report.
+static void report(int elapsed, const LoadStats* previous)
+{
+  int running = 0;
+  for (int i = 0; i < sOpened; i++) {
+    running += sClients[i].used;
+  }
+  printf("[%4ds] running %5d, started %6d, completed %6d, failed %5d, "
+    "sent %7d msg/s, received %7d msg/s, overruns %d, stalls %d\n",
+    elapsed / 1000, running, sStats.started, sStats.completed, sStats.failed,
+    (sStats.sent - previous->sent) * 1000 / LOADGEN_REPORT_INTERVAL,
+    (sStats.received - previous->received) * 1000 / LOADGEN_REPORT_INTERVAL,
+    sStats.overruns, sStats.stalls);
+  fflush(stdout);
+}
+
+// ============================================================================
+// get the round-trip time (ms) below which the given percentage of samples are.
+static int rtt_percentile(int percentage)
+{
+  int threshold = SDL_min((int)((Sint64)sStats.rtt_count * percentage / 100), sStats.rtt_count - 1);
+  int count = 0;
+  for (int i = 0; i < LOADGEN_RTT_BUCKETS; i++) {
+    count += sStats.rtt[i];
+    if (count > threshold) {
+      return i;
+    }
+  }
+  return LOADGEN_RTT_BUCKETS - 1;
+}
+
+// ============================================================================
+// parse the command line arguments and resolve the server address.
+static void parse_arguments(int argc, char* argv[])
+{
+  const char* host = "127.0.0.1";
+  int positionals = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--clients=", 10) == 0) {
+      sClientCount = SDL_max(1, SDL_min(atoi(argv[i] + 10), LOADGEN_MAX_CLIENTS));
+    } else if (strncmp(argv[i], "--rate=", 7) == 0) {
+      sRate = SDL_max(1, atoi(argv[i] + 7));
+    } else if (strncmp(argv[i], "--duration=", 11) == 0) {
+      sDuration = SDL_max(1, atoi(argv[i] + 11));
+    } else if (strncmp(argv[i], "--bot-reaction=", 15) == 0) {
+      sBotReaction = SDL_max(0, atoi(argv[i] + 15));
+    } else if (strncmp(argv[i], "--bot-error=", 12) == 0) {
+      sBotError = SDL_max(0, atoi(argv[i] + 12));
+    } else if (strcmp(argv[i], "--text") == 0) {
+      protocol_set_format(TEXT);
+    } else if (argv[i][0] != '-' && positionals == 0) {
+      sTransport = (strncmp("tcp", argv[i], 3) == 0 ? TCP : UDP);
+      positionals++;
+    } else if (argv[i][0] != '-' && positionals == 1) {
+      host = argv[i];
+      positionals++;
+    } else {
+      printf("Usage: %s [--clients=N] [--rate=N] [--duration=S] [--bot-reaction=MS] "
+        "[--bot-error=PX] [--text] [tcp|udp] [host]\n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // resolve the IPv4 address of the server.
+  struct addrinfo hints;
+  struct addrinfo* result = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+    printf("Unable to resolve the host %s\n", host);
+    exit(EXIT_FAILURE);
+  }
+  memcpy(&sAddress, result->ai_addr, sizeof(sAddress));
+  sAddress.sin_port = htons(NETWORK_PORT);
+  freeaddrinfo(result);
+  printf("Running %d %s bot client(s) against %s for %d seconds...\n",
+    sClientCount, (sTransport == TCP ? "TCP" : "UDP"), host, sDuration);
+}
+
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+  parse_arguments(argc, argv);
+  match_set_verbose(0);
+
+  // make room for a socket per client.
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)sClientCount + 64) {
+    limit.rlim_cur = SDL_min(limit.rlim_max, (rlim_t)sClientCount + 64);
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0) {
+      perror("setrlimit");
+    }
+  }
+
+  sClients = SDL_calloc(sClientCount, sizeof(Client));
+  sEpoll = epoll_create1(0);
+  if (sClients == NULL || sEpoll < 0) {
+    printf("Unable to allocate %d clients!\n", sClientCount);
+    return EXIT_FAILURE;
+  }
+
+  int started = SDL_GetTicks();
+  int nextTick = started + TIMESTEP;
+  int nextReport = started + LOADGEN_REPORT_INTERVAL;
+  LoadStats previous = sStats;
+  struct epoll_event events[LOADGEN_MAX_EVENTS];
+  while ((int)SDL_GetTicks() - started < sDuration * 1000) {
+    // sleep on the sockets until the next tick unless data arrives.
+    int timeout = nextTick - (int)SDL_GetTicks();
+    int count = epoll_wait(sEpoll, events, LOADGEN_MAX_EVENTS, (timeout > 0 ? timeout : 0));
+    if (count < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      break;
+    }
+    for (int i = 0; i < count; i++) {
+      Client* client = events[i].data.ptr;
+      if (client->used == 1) {
+        client_read(client);
+      }
+    }
+
+    int ticks = SDL_GetTicks();
+    if (ticks >= nextTick) {
+      // ramp up the amount of clients with the configured connection rate.
+      int target = (int)((Sint64)(ticks - started) * sRate / 1000) + 1;
+      sOpened = SDL_max(sOpened, SDL_min(target, sClientCount));
+      tick();
+      sStats.ticks++;
+
+      nextTick += TIMESTEP;
+      if (nextTick <= (int)SDL_GetTicks()) {
+        sStats.overruns++;
+        nextTick = SDL_GetTicks() + TIMESTEP;
+      }
+    }
+    if (ticks >= nextReport) {
+      report(ticks - started, &previous);
+      previous = sStats;
+      nextReport += LOADGEN_REPORT_INTERVAL;
+    }
+  }
+
+  // count the matches still running at the end as sustained ones.
+  int running = 0;
+  for (int i = 0; i < sOpened; i++) {
+    if (sClients[i].used == 1) {
+      running++;
+      sClients[i].match.left_points = SCORE_LIMIT;
+      client_close(&sClients[i]);
+    }
+  }
+  sStats.completed -= running;
+
+  int elapsed = SDL_max(1, (int)SDL_GetTicks() - started);
+  printf("Sustained %d of %d match(es) with %d completed and %d failed.\n",
+    running, sClientCount, sStats.completed, sStats.failed);
+  printf("Ran %d ticks with %d overrun(s) and %d server stall(s).\n",
+    sStats.ticks, sStats.overruns, sStats.stalls);
+  printf("Sent %d messages (%lld bytes) and received %d messages (%lld bytes) at %d / %d msg/s.\n",
+    sStats.sent, (long long)sStats.sent_bytes, sStats.received, (long long)sStats.received_bytes,
+    (int)((Sint64)sStats.sent * 1000 / elapsed), (int)((Sint64)sStats.received * 1000 / elapsed));
+  printf("Round-trip times of %d samples: p50 %d ms, p90 %d ms, p99 %d ms, max %d ms.\n",
+    sStats.rtt_count, rtt_percentile(50), rtt_percentile(90), rtt_percentile(99),
+    rtt_percentile(100));
+
+  close(sEpoll);
+  SDL_free(sClients);
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main(int argc, char* argv[])
+{
+  (void)argc;
+  (void)argv;
+  printf("The load generator requires the epoll API (Linux)!\n");
+  return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,428 @@
+#include <SDL/SDL.h>
+
+#include "game.h"
+#include "protocol.h"
+#include "record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the maximum amount of replayed messages waiting to be compared against the recording.
+#define REPLAY_MAX_PENDING 256
+// the interval (ms) of polling the window events while waiting.
+#define REPLAY_EVENT_WAIT 10
+
+typedef struct {
+  // the encoded message produced by the replayed match.
+  Uint8 data[PROTOCOL_MAX_MESSAGE_SIZE];
+  // the size of the encoded message in bytes.
+  int size;
+} PendingMessage;
+
+// the path to the replayed recording.
+static const char* sPath = NULL;
+// the playback speed relative to the recording (zero for as fast as possible).
+static double sSpeed = 0.0;
+// a definition whether to wait for a key press after each frame.
+static int sStep = 0;
+// a definition whether to print the state of each frame.
+static int sPrint = 0;
+// a definition whether to render each frame into a window.
+static int sRender = 0;
+
+// the memory-mapped contents of the recording.
+static const Uint8* sData = NULL;
+// the size of the recording in bytes.
+static int sSize = 0;
+#ifdef _WIN32
+// the handle of the file mapping of the recording.
+static HANDLE sMapping = NULL;
+#endif
+
+// the virtual local time of the replayed node.
+static int sNow = 0;
+// the replayed match.
+static Match sMatch;
+// the window showing the replayed frames.
+static SDL_Window* sWindow = NULL;
+// the renderer drawing the replayed frames.
+static SDL_Renderer* sRenderer = NULL;
+
+// the messages sent by the replayed match in the order of sending.
+static PendingMessage sPending[REPLAY_MAX_PENDING];
+// the index of the oldest pending message.
+static int sPendingFirst = 0;
+// the amount of pending messages.
+static int sPendingCount = 0;
+// the amount of replayed messages which differ from the recorded ones.
+static int sDesyncs = 0;
+// the time of the first replayed message which differed from the recorded one (-1 for none).
+static int sFirstDesync = -1;
+// the amount of gaps where the recorder dropped events.
+static int sGaps = 0;
+// the amount of events dropped by the recorder.
+static int sDroppedEvents = 0;
+// the time of the first gap (-1 for none).
+static int sFirstGap = -1;
+// the amount of replayed messages which differed from the recorded ones after a gap.
+static int sUnverified = 0;
+
+// ============================================================================
+// get the virtual local time of the replayed node.
+static Uint32 replay_ticks()
+{
+  return (Uint32)sNow;
+}
+
+// ============================================================================
+// collect a message sent by the replayed match to be compared against the recording.
+static void replay_send(Match* match, const Message* msg)
+{
+  (void)match;
+  if (sPendingCount == REPLAY_MAX_PENDING) {
+    printf("More than %d sent messages without a recorded counterpart!\n", REPLAY_MAX_PENDING);
+    exit(EXIT_FAILURE);
+  }
+  PendingMessage* pending = &sPending[(sPendingFirst + sPendingCount) % REPLAY_MAX_PENDING];
+  pending->size = protocol_pack(msg, pending->data, PROTOCOL_MAX_MESSAGE_SIZE);
+  sPendingCount++;
+}
+
+// ============================================================================
+// compare the recorded sent message against the oldest message sent by the replay.
+static void compare_sent(const RecordEvent* event)
+{
+  int matches = 0;
+  if (sPendingCount > 0) {
+    PendingMessage* pending = &sPending[sPendingFirst];
+    matches = (pending->size == event->size && memcmp(pending->data, event->data, event->size) == 0);
+    sPendingFirst = (sPendingFirst + 1) % REPLAY_MAX_PENDING;
+    sPendingCount--;
+  }
+
+  // the match cannot be reproduced after a gap, so the differences are not desyncs.
+  if (matches == 0 && sGaps > 0) {
+    sUnverified++;
+  } else if (matches == 0) {
+    sDesyncs++;
+    if (sFirstDesync == -1) {
+      sFirstDesync = event->time;
+    }
+  }
+}
+
+// ============================================================================
+// unmap the recording from the memory.
+static void unmap_recording()
+{
+#ifdef _WIN32
+  UnmapViewOfFile(sData);
+  CloseHandle(sMapping);
+#else
+  munmap((void*)sData, sSize);
+#endif
+}
+
+// ============================================================================
+// map the whole recording into the memory to read the events without copying.
+static void map_recording()
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(sPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL, NULL);
+  LARGE_INTEGER size;
+  if (file == INVALID_HANDLE_VALUE || GetFileSizeEx(file, &size) == 0) {
+    printf("Unable to open the recording %s\n", sPath);
+    exit(EXIT_FAILURE);
+  }
+  sSize = (int)size.QuadPart;
+  sMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  sData = (sMapping == NULL ? NULL : MapViewOfFile(sMapping, FILE_MAP_READ, 0, 0, 0));
+  if (sData == NULL) {
+    printf("Unable to map the recording %s\n", sPath);
+    exit(EXIT_FAILURE);
+  }
+#else
+  int file = open(sPath, O_RDONLY);
+  struct stat info;
+  if (file < 0 || fstat(file, &info) != 0) {
+    perror(sPath);
+    exit(EXIT_FAILURE);
+  }
+  sSize = (int)info.st_size;
+  void* data = (sSize > 0 ? mmap(NULL, sSize, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED);
+  close(file);
+  if (data == MAP_FAILED) {
+    printf("Unable to map the recording %s\n", sPath);
+    exit(EXIT_FAILURE);
+  }
+  sData = data;
+#endif
+  atexit(unmap_recording);
+}
+
+// ============================================================================
+// destroy the replay window and its renderer.
+static void destroy_window()
+{
+  SDL_DestroyRenderer(sRenderer);
+  SDL_DestroyWindow(sWindow);
+  SDL_Quit();
+}
+
+// ============================================================================
+// create the window showing the replayed frames.
+static void create_window()
+{
+  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    exit(EXIT_FAILURE);
+  }
+  sWindow = SDL_CreateWindow("pong replay", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+    RESOLUTION_WIDTH, RESOLUTION_HEIGHT, SDL_WINDOW_SHOWN);
+  if (sWindow == NULL) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    exit(EXIT_FAILURE);
+  }
+  sRenderer = SDL_CreateRenderer(sWindow, -1, 0);
+  if (sRenderer == NULL) {
+    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+    exit(EXIT_FAILURE);
+  }
+  atexit(destroy_window);
+}
+
+// ============================================================================
+// print and render the interpolated state of the match at the given time.
+static void show_frame(int time)
+{
+  SDL_Rect left = state_view(&sMatch, &sMatch.left_paddle, time);
+  SDL_Rect right = state_view(&sMatch, &sMatch.right_paddle, time);
+  SDL_Rect ball = state_view(&sMatch, &sMatch.ball, time);
+  if (sPrint == 1) {
+    printf("[%8d] left %3d, right %3d, ball %3d,%3d, score %d-%d\n", time, left.y, right.y,
+      ball.x, ball.y, sMatch.left_points, sMatch.right_points);
+  }
+  if (sRenderer != NULL) {
+    SDL_Rect rects[] = { TOP_WALL, BOTTOM_WALL, left, right, ball };
+    SDL_SetRenderDrawColor(sRenderer, 0x00, 0x00, 0x00, 0x00);
+    SDL_RenderClear(sRenderer);
+    SDL_SetRenderDrawColor(sRenderer, 0xff, 0xff, 0xff, 0xff);
+    SDL_RenderFillRects(sRenderer, rects, 5);
+    SDL_RenderPresent(sRenderer);
+  }
+}
+
+// ============================================================================
+// handle the pending window events. returns zero when the replay should stop.
+static int handle_events(int timeout, int* advance)
+{
+  SDL_Event event;
+  while (SDL_WaitEventTimeout(&event, timeout) != 0) {
+    if (event.type == SDL_QUIT
+      || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
+      return 0;
+    } else if (event.type == SDL_KEYDOWN) {
+      *advance = 1;
+    }
+    timeout = 0;
+  }
+  return 1;
+}
+
+// ============================================================================
+// wait until the next frame should be shown. returns zero when the replay should stop.
+static int wait_frame(int time, int startTime, Uint32 started)
+{
+  int advance = 0;
+  if (sStep == 1 && sRenderer == NULL) {
+    // advance the frames with the enter key on the console.
+    int c = getchar();
+    while (c != '\n' && c != EOF) {
+      c = getchar();
+    }
+    return (c == EOF ? 0 : 1);
+  } else if (sStep == 1) {
+    while (advance == 0) {
+      if (handle_events(REPLAY_EVENT_WAIT, &advance) == 0) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  // keep the pace of the recording scaled by the playback speed.
+  if (sSpeed > 0.0) {
+    int due = (int)((time - startTime) / sSpeed);
+    int elapsed = (int)(SDL_GetTicks() - started);
+    if (due > elapsed) {
+      SDL_Delay(due - elapsed);
+    }
+  }
+  return (sRenderer == NULL ? 1 : handle_events(0, &advance));
+}
+
+// ============================================================================
+// parse the command line arguments.
+static void parse_arguments(int argc, char* argv[])
+{
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--speed=", 8) == 0) {
+      sSpeed = SDL_max(0.0, atof(argv[i] + 8));
+    } else if (strcmp(argv[i], "--step") == 0) {
+      sStep = 1;
+    } else if (strcmp(argv[i], "--print") == 0) {
+      sPrint = 1;
+    } else if (strcmp(argv[i], "--render") == 0) {
+      sRender = 1;
+    } else if (argv[i][0] != '-' && sPath == NULL) {
+      sPath = argv[i];
+    } else {
+      printf("Usage: %s [--speed=N] [--step] [--print] [--render] recording\n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (sPath == NULL) {
+    printf("Usage: %s [--speed=N] [--step] [--print] [--render] recording\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+}
+
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+  parse_arguments(argc, argv);
+  map_recording();
+
+  RecordHeader header;
+  int offset = record_read_header(sData, sSize, &header);
+  if (offset < 0) {
+    printf("%s is not a recording (version %d)!\n", sPath, RECORD_VERSION);
+    return EXIT_FAILURE;
+  }
+  printf("Replaying %s: %s, %s netcode, %d bytes\n", sPath,
+    (header.mode == SERVER ? "server" : "client"),
+    (header.netcode == NETCODE_ROLLBACK ? "rollback"
+      : (header.netcode == NETCODE_PREDICT ? "predict" : "lag")), sSize);
+
+  // restore the configuration of the recording node and drive the match by the recorded time.
+  srand(header.seed);
+  match_set_netcode(header.netcode);
+  snapshot_set_keyframe_interval(header.keyframe_interval);
+  match_set_verbose(0);
+  match_set_time_source(&replay_ticks);
+  sNow = header.time;
+  match_init(&sMatch, header.mode, &replay_send, NULL);
+  if (sRender == 1) {
+    create_window();
+  }
+
+  // the paddle controlled by the local player of the recording node.
+  DynamicObject* paddle = (header.mode == SERVER ? &sMatch.left_paddle : &sMatch.right_paddle);
+  int direction = NONE;
+  int events = 0;
+  int frames = 0;
+  Uint32 started = SDL_GetTicks();
+  Uint64 startedCounter = SDL_GetPerformanceCounter();
+  for (;;) {
+    RecordEvent event;
+    int length = record_read_event(sData + offset, sSize - offset, &event);
+    if (length == 0) {
+      break;
+    } else if (length < 0) {
+      printf("The recording is truncated at byte %d\n", offset);
+      break;
+    }
+    offset += length;
+    events++;
+    sNow = event.time;
+
+    switch (event.type) {
+      case RECORD_START:
+        match_start(&sMatch);
+        break;
+      case RECORD_POLL:
+        match_poll(&sMatch);
+        break;
+      case RECORD_INPUT:
+        direction = record_read_value(&event);
+        break;
+      case RECORD_UPDATE: {
+        // the match may have reset the direction since the last recorded change.
+        int stepTime = record_read_value(&event);
+        paddle->direction_y = direction;
+        match_update(&sMatch, stepTime);
+        sMatch.previous_tick = stepTime;
+        frames++;
+        if (sPrint == 1 || sRenderer != NULL) {
+          show_frame(stepTime);
+        }
+        if ((sStep == 1 || sSpeed > 0.0 || sRenderer != NULL)
+          && wait_frame(event.time, header.time, started) == 0) {
+          offset = sSize;
+        }
+        break;
+      }
+      case RECORD_RECEIVED: {
+        Message msg;
+        if (protocol_unpack(event.data, event.size, &msg) != event.size) {
+          printf("Malformed message recorded at %d\n", event.time);
+          return EXIT_FAILURE;
+        }
+        match_dispatch(&sMatch, &msg);
+        break;
+      }
+      case RECORD_SENT:
+        compare_sent(&event);
+        break;
+      case RECORD_GAP:
+        // the messages sent during the gap have no recorded counterparts.
+        if (sFirstGap == -1) {
+          sFirstGap = event.time;
+        }
+        sGaps++;
+        sDroppedEvents += record_read_value(&event);
+        sPendingFirst = 0;
+        sPendingCount = 0;
+        break;
+    }
+    if (offset == sSize) {
+      break;
+    }
+  }
+
+  // the messages sent after the last recorded one never reached the recording.
+  if (sGaps > 0) {
+    sUnverified += sPendingCount;
+  } else {
+    sDesyncs += sPendingCount;
+  }
+  double elapsed = (double)(SDL_GetPerformanceCounter() - startedCounter) * 1000.0
+    / (double)SDL_GetPerformanceFrequency();
+  int duration = sNow - header.time;
+  printf("Replayed %d event(s) and %d frame(s) of %.1f s in %.1f ms (%.0fx real time)\n",
+    events, frames, duration / 1000.0, elapsed, (elapsed > 0.0 ? duration / elapsed : 0.0));
+  printf("Final score %d-%d, %d desynchronized message(s)", sMatch.left_points,
+    sMatch.right_points, sDesyncs);
+  if (sFirstDesync >= 0) {
+    printf(" (first at %d ms)", sFirstDesync - header.time);
+  }
+  printf("\n");
+  if (sGaps > 0) {
+    printf("%d gap(s) of %d dropped event(s) from %d ms on, %d message(s) differed after them\n",
+      sGaps, sDroppedEvents, sFirstGap - header.time, sUnverified);
+  }
+  return (sDesyncs == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
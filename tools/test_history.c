@@ -0,0 +1,216 @@
+#include <SDL/SDL.h>
+
+#include "history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// check the condition and report the failing expression with its line.
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+// the amount of failed checks.
+static int sFailures = 0;
+// the amount of run checks.
+static int sChecks = 0;
+
+// ============================================================================
+// count the check and report it when it failed.
+static void check(int passed, const char* expression, int line)
+{
+  sChecks++;
+  if (passed == 0) {
+    printf("test_history.c:%d: check failed: %s\n", line, expression);
+    sFailures++;
+  }
+}
+
+// ============================================================================
+// get a rect with the given position and a fixed size.
+static SDL_Rect rect_at(int x, int y)
+{
+  SDL_Rect rect = { x, y, 10, 20 };
+  return rect;
+}
+
+// ============================================================================
+// check that the history contains states in increasing time order.
+static int is_ordered(const History* history)
+{
+  for (int i = 1; i < history->count; i++) {
+    int previous = history->states[(history->head + i - 1) % HISTORY_MAX_DEPTH].time;
+    int current = history->states[(history->head + i) % HISTORY_MAX_DEPTH].time;
+    if (previous > current) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// ============================================================================
+// the oldest state is dropped when the ring is full and the ring wraps around.
+static void test_wraparound()
+{
+  History history;
+  SDL_Rect rect = rect_at(0, 0);
+  history_init(&history, &rect, HISTORY_MIN_DEPTH);
+
+  // add enough states to leave the ring spanning over the end of the array.
+  int total = HISTORY_MAX_DEPTH + 5;
+  for (int i = 1; i <= total; i++) {
+    rect = rect_at(i, i * 2);
+    history_add(&history, &rect, i * 10);
+  }
+  CHECK(history.count == HISTORY_MIN_DEPTH);
+  CHECK(history.head + history.count > HISTORY_MAX_DEPTH);
+  CHECK(history_newest(&history)->time == total * 10);
+  CHECK(history.states[history.head].time == (total - HISTORY_MIN_DEPTH + 1) * 10);
+  CHECK(is_ordered(&history));
+  for (int i = total - HISTORY_MIN_DEPTH + 1; i <= total; i++) {
+    CHECK(history_get(&history, i * 10).x == i);
+  }
+
+  // a state older than the whole full ring is ignored.
+  rect = rect_at(-1, -1);
+  history_add(&history, &rect, 0);
+  CHECK(history.count == HISTORY_MIN_DEPTH);
+  CHECK(history_get(&history, 0).x == total - HISTORY_MIN_DEPTH + 1);
+}
+
+// ============================================================================
+// the states are kept in time order and the lookups use the surrounding states.
+static void test_lookup()
+{
+  History history;
+  SDL_Rect rect = rect_at(0, 0);
+  history_init(&history, &rect, HISTORY_MAX_DEPTH);
+
+  // add reordered states which are inserted into their time order.
+  const int times[] = { 30, 10, 50, 20, 40 };
+  for (int i = 0; i < 5; i++) {
+    rect = rect_at(times[i], 0);
+    history_add(&history, &rect, times[i]);
+  }
+  CHECK(history.count == 6);
+  CHECK(is_ordered(&history));
+  CHECK(history_newest(&history)->time == 50);
+
+  // exact times hit their states and the boundaries clamp to the oldest and newest states.
+  for (int i = 0; i < 5; i++) {
+    CHECK(history_get(&history, times[i]).x == times[i]);
+  }
+  CHECK(history_get(&history, -100).x == 0);
+  CHECK(history_get(&history, 1000).x == 50);
+
+  // a duplicate time is placed after the existing state and wins the lookup.
+  rect = rect_at(99, 0);
+  history_add(&history, &rect, 30);
+  CHECK(is_ordered(&history));
+  CHECK(history_get(&history, 30).x == 99);
+}
+
+// ============================================================================
+// the rect between two states is interpolated linearly within a tick.
+static void test_lerp()
+{
+  History history;
+  SDL_Rect rect = rect_at(0, 100);
+  history_init(&history, &rect, HISTORY_MIN_DEPTH);
+  rect = rect_at(100, 0);
+  history_add(&history, &rect, 10);
+
+  CHECK(history_get(&history, 5).x == 50);
+  CHECK(history_get(&history, 5).y == 50);
+  CHECK(history_get(&history, 3).x == 30);
+  CHECK(history_get(&history, 3).y == 70);
+  CHECK(history_get(&history, 7).w == 10);
+  CHECK(history_get(&history, 7).h == 20);
+
+  // states with the same time are not divided by a zero duration.
+  rect = rect_at(200, 0);
+  history_add(&history, &rect, 10);
+  CHECK(history_get(&history, 10).x == 200);
+}
+
+// ============================================================================
+// clearing replaces the states from the given time with a single state.
+static void test_clear()
+{
+  History history;
+  SDL_Rect rect = rect_at(0, 0);
+  history_init(&history, &rect, HISTORY_MAX_DEPTH);
+  for (int i = 1; i <= 5; i++) {
+    rect = rect_at(i, 0);
+    history_add(&history, &rect, i * 10);
+  }
+
+  rect = rect_at(77, 0);
+  history_clear(&history, &rect, 30);
+  CHECK(history.count == 4);
+  CHECK(history_newest(&history)->time == 30);
+  CHECK(history_newest(&history)->rect.x == 77);
+  CHECK(history_get(&history, 20).x == 2);
+  CHECK(history_get(&history, 50).x == 77);
+
+  // clearing from before every state leaves only the new one.
+  history_clear(&history, &rect, -10);
+  CHECK(history.count == 1);
+  CHECK(history_newest(&history)->time == -10);
+}
+
+// ============================================================================
+// changing the depth drops the oldest states and clamps into the allowed range.
+static void test_set_depth()
+{
+  History history;
+  SDL_Rect rect = rect_at(0, 0);
+  history_init(&history, &rect, 32);
+  for (int i = 1; i < 32; i++) {
+    rect = rect_at(i, 0);
+    history_add(&history, &rect, i * 10);
+  }
+  CHECK(history.count == 32);
+
+  // shrinking keeps only the newest states.
+  history_set_depth(&history, 16);
+  CHECK(history.depth == 16);
+  CHECK(history.count == 16);
+  CHECK(history.states[history.head].time == 160);
+  CHECK(history_newest(&history)->time == 310);
+  CHECK(is_ordered(&history));
+
+  // growing keeps the states and lets the ring fill up to the new depth.
+  history_set_depth(&history, 64);
+  CHECK(history.depth == 64);
+  CHECK(history.count == 16);
+  for (int i = 32; i < 100; i++) {
+    rect = rect_at(i, 0);
+    history_add(&history, &rect, i * 10);
+  }
+  CHECK(history.count == 64);
+  CHECK(history.states[history.head].time == 360);
+  CHECK(is_ordered(&history));
+
+  // the depth is clamped into the supported range.
+  history_set_depth(&history, 0);
+  CHECK(history.depth == HISTORY_MIN_DEPTH);
+  CHECK(history.count == HISTORY_MIN_DEPTH);
+  history_set_depth(&history, HISTORY_MAX_DEPTH * 2);
+  CHECK(history.depth == HISTORY_MAX_DEPTH);
+}
+
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  test_wraparound();
+  test_lookup();
+  test_lerp();
+  test_clear();
+  test_set_depth();
+
+  printf("test_history: %d of %d check(s) passed\n", sChecks - sFailures, sChecks);
+  return (sFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
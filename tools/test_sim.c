@@ -0,0 +1,129 @@
+#include <SDL/SDL.h>
+
+#include "game.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// check the condition and report the failing expression with its line.
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+// the amount of simulated steps in the comparisons (long enough for several points).
+#define TEST_SIM_STEPS 20000
+
+// the amount of failed checks.
+static int sFailures = 0;
+// the amount of run checks.
+static int sChecks = 0;
+
+// ============================================================================
+// count the check and report it when it failed.
+static void check(int passed, const char* expression, int line)
+{
+  sChecks++;
+  if (passed == 0) {
+    printf("test_sim.c:%d: check failed: %s\n", line, expression);
+    sFailures++;
+  }
+}
+
+// ============================================================================
+// get a varying input for both paddles at the given step.
+static SimInput input_at(int step)
+{
+  SimInput input = {
+    sim_unpack_input((step / 7) % 3),
+    sim_unpack_input((step / 11) % 3)
+  };
+  return input;
+}
+
+// ============================================================================
+// stepping in place and into a separate state simulate the same game.
+static void test_aliasing()
+{
+  SimState aliased;
+  SimState separate[2];
+  sim_init(&aliased, 12345);
+  sim_init(&separate[0], 12345);
+
+  int diverged = -1;
+  for (int step = 0; step < TEST_SIM_STEPS && diverged == -1; step++) {
+    SimInput input = input_at(step);
+    int events = sim_step(&aliased, &input, &aliased);
+    int expected = sim_step(&separate[step % 2], &input, &separate[(step + 1) % 2]);
+    if (events != expected || memcmp(&aliased, &separate[(step + 1) % 2], sizeof(SimState)) != 0) {
+      diverged = step;
+    }
+  }
+  if (diverged != -1) {
+    printf("test_sim.c: the aliased simulation diverged at step %d\n", diverged);
+  }
+  CHECK(diverged == -1);
+  CHECK(aliased.left_points + aliased.right_points > 0);
+
+  // the same check for the moves without the scoring rules.
+  sim_init(&aliased, 99);
+  sim_init(&separate[0], 99);
+  diverged = -1;
+  for (int step = 0; step < 200 && diverged == -1; step++) {
+    SimInput input = input_at(step);
+    sim_move(&aliased, &input, &aliased);
+    sim_move(&separate[step % 2], &input, &separate[(step + 1) % 2]);
+    if (memcmp(&aliased, &separate[(step + 1) % 2], sizeof(SimState)) != 0) {
+      diverged = step;
+    }
+  }
+  CHECK(diverged == -1);
+}
+
+// ============================================================================
+// the ball stays still during the countdown and moves on the launch tick.
+static void test_launch()
+{
+  SimState state;
+  SimInput input = { NONE, NONE };
+  sim_init(&state, 1);
+  Fixed x = state.ball_x;
+  Uint32 launch = state.launch_tick;
+  CHECK(launch > 0);
+  while (state.tick < launch) {
+    sim_step(&state, &input, &state);
+    CHECK(state.ball_x == x);
+  }
+  sim_step(&state, &input, &state);
+  CHECK(state.ball_x != x);
+}
+
+// ============================================================================
+// the same seed and inputs reproduce the same states.
+static void test_determinism()
+{
+  SimState a;
+  SimState b;
+  sim_init(&a, 777);
+  sim_init(&b, 777);
+  for (int step = 0; step < TEST_SIM_STEPS; step++) {
+    SimInput input = input_at(step);
+    sim_step(&a, &input, &a);
+    sim_step(&b, &input, &b);
+  }
+  CHECK(memcmp(&a, &b, sizeof(SimState)) == 0);
+}
+
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  test_aliasing();
+  test_launch();
+  test_determinism();
+
+  printf("test_sim: %d of %d check(s) passed\n", sChecks - sFailures, sChecks);
+  return (sFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,112 @@
+#include "trace.h"
+
+#include <stdio.h>
+
+typedef struct {
+  // the index of the event plus one or zero while the event is being written.
+  SDL_atomic_t stamp;
+  // the category of the event.
+  const char* category;
+  // the name of the event.
+  const char* name;
+  // the performance counter value at the start of the scope.
+  Uint64 start;
+  // the length of the scope in performance counter ticks.
+  Uint64 duration;
+  // the thread where the scope was recorded.
+  SDL_threadID thread;
+} TraceEvent;
+
+// the ring of the most recent events overwritten by the newer ones.
+static TraceEvent sEvents[TRACE_BUFFER_SIZE];
+// the index of the next event to be written.
+static SDL_atomic_t sNext;
+// the file where the trace events are written (NULL when tracing is disabled).
+static const char* sFile = NULL;
+// the performance counter value when the tracing was enabled.
+static Uint64 sOrigin = 0;
+
+// ============================================================================
+
+void trace_set_file(const char* path)
+{
+  sFile = path;
+  sOrigin = SDL_GetPerformanceCounter();
+}
+
+// ============================================================================
+
+const char* trace_get_file()
+{
+  return sFile;
+}
+
+// ============================================================================
+
+Uint64 trace_begin()
+{
+  return (sFile == NULL ? 0 : SDL_GetPerformanceCounter());
+}
+
+// ============================================================================
+
+void trace_end(const char* category, const char* name, Uint64 started)
+{
+  if (started == 0) {
+    return;
+  }
+  Uint64 now = SDL_GetPerformanceCounter();
+
+  // reserve a slot without locks and mark it incomplete until all fields are written.
+  Uint32 index = (Uint32)SDL_AtomicAdd(&sNext, 1);
+  TraceEvent* event = &sEvents[index & (TRACE_BUFFER_SIZE - 1)];
+  SDL_AtomicSet(&event->stamp, 0);
+  event->category = category;
+  event->name = name;
+  event->start = started;
+  event->duration = now - started;
+  event->thread = SDL_ThreadID();
+  SDL_AtomicSet(&event->stamp, (int)(index + 1));
+}
+
+// ============================================================================
+
+void trace_flush()
+{
+  if (sFile == NULL) {
+    return;
+  }
+  FILE* file = fopen(sFile, "w");
+  if (file == NULL) {
+    perror("fopen");
+    return;
+  }
+
+  // write the buffered events from the oldest to the newest one.
+  double scale = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+  Uint32 next = (Uint32)SDL_AtomicGet(&sNext);
+  Uint32 first = (next > TRACE_BUFFER_SIZE ? next - TRACE_BUFFER_SIZE : 0);
+  int written = 0;
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  for (Uint32 index = first; index != next; index++) {
+    // skip the events which are being written or were overwritten while copied.
+    TraceEvent* slot = &sEvents[index & (TRACE_BUFFER_SIZE - 1)];
+    int stamp = SDL_AtomicGet(&slot->stamp);
+    TraceEvent event = *slot;
+    SDL_MemoryBarrierAcquire();
+    if (stamp != (int)(index + 1) || SDL_AtomicGet(&slot->stamp) != stamp) {
+      continue;
+    }
+    fprintf(file, "%s\n{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+      "\"ts\":%.3f,\"dur\":%.3f}", (written > 0 ? "," : ""), event.category, event.name,
+      (unsigned long)event.thread, (double)(event.start - sOrigin) * scale,
+      (double)event.duration * scale);
+    written++;
+  }
+  fprintf(file, "\n]}\n");
+  if (fclose(file) != 0) {
+    perror("fclose");
+    return;
+  }
+  printf("Wrote %d trace event(s) into %s\n", written, sFile);
+}
@@ -0,0 +1,23 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <SDL/SDL.h>
+
+// the amount of most recent events kept in the trace buffer (a power of two).
+#define TRACE_BUFFER_SIZE 65536
+
+// ============================================================================
+
+// record trace events to be written into the given file (NULL to disable tracing).
+void trace_set_file(const char* path);
+// get the file where the trace events are written (NULL when tracing is disabled).
+const char* trace_get_file();
+
+// get the start time of a traced scope or zero when tracing is disabled.
+Uint64 trace_begin();
+// record the scope started at the given time with a static category and name (any thread).
+void trace_end(const char* category, const char* name, Uint64 started);
+// write the buffered events into the trace file in the Chrome trace event format.
+void trace_flush();
+
+#endif